@@ -0,0 +1,100 @@
+/**
+ * Check that inference through setInput(const T*, size_t), propagate() and
+ * getOutputs(T*, size_t) does no heap allocation once the network is built. The global
+ * operator new is replaced by one counting the allocations, and the count is compared
+ * before and after many propagations, with the single-threaded and the threaded forward
+ * pass, in double and single precision and with the quantized network. The program
+ * exits with status 1 if any allocation happened.
+ *
+ * by BlackLight, 2009
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <neural++.hpp>
+
+using namespace std;
+using namespace neuralpp;
+
+static unsigned long allocations = 0;
+
+void* operator new (size_t size) throw(std::bad_alloc)  {
+	void *p = malloc((size) ? size : 1);
+
+	if (!p)
+		throw std::bad_alloc();
+
+	allocations++;
+	return p;
+}
+
+void* operator new[] (size_t size) throw(std::bad_alloc)  {
+	return operator new(size);
+}
+
+void operator delete (void *p) throw()  {
+	free(p);
+}
+
+void operator delete[] (void *p) throw()  {
+	free(p);
+}
+
+#define	IN_SIZE	32
+#define	HIDDEN_SIZE	2048
+#define	OUT_SIZE	4
+#define	RUNS	1000
+
+/**
+ * Run the inference loop on a network and tell whether it allocated anything
+ */
+template <class Net, typename T>
+static bool steady (Net& net, const char *name)  {
+	T in[IN_SIZE], out[OUT_SIZE];
+
+	for (size_t i = 0; i < IN_SIZE; i++)
+		in[i] = (T) i / IN_SIZE;
+
+	// First run out of the count, as the network may set up its buffers
+	net.setInput(in, IN_SIZE);
+	net.propagate();
+	net.getOutputs(out, OUT_SIZE);
+
+	unsigned long before = allocations;
+
+	for (size_t r = 0; r < RUNS; r++)  {
+		in[r % IN_SIZE] += (T) 0.001;
+		net.setInput(in, IN_SIZE);
+		net.propagate();
+		net.getOutputs(out, OUT_SIZE);
+	}
+
+	unsigned long n = allocations - before;
+	cout << name << ": " << n << " allocations in " << RUNS << " propagations\n";
+	return n == 0;
+}
+
+int main()  {
+	bool ok = true;
+
+	NeuralNet net(IN_SIZE, HIDDEN_SIZE, OUT_SIZE, 0.005, 1, 0.0, activation::sigmoid, 1);
+	ok &= steady<NeuralNet, double>(net, "NeuralNet");
+
+	net.setThreads(4, 1024);
+	ok &= steady<NeuralNet, double>(net, "NeuralNet, 4 threads");
+
+	FloatNeuralNet fnet(IN_SIZE, HIDDEN_SIZE, OUT_SIZE, 0.005f, 1, 0.0f, activation::sigmoid, 1);
+	ok &= steady<FloatNeuralNet, float>(fnet, "FloatNeuralNet");
+
+	QuantizedNeuralNet qnet(net);
+	ok &= steady<QuantizedNeuralNet, double>(qnet, "QuantizedNeuralNet");
+
+	if (!ok)  {
+		cerr << "Steady-state propagation allocated memory\n";
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -0,0 +1,127 @@
+/**
+ * Check that data loaded through a memory mapping can be saved back over the file it
+ * was mapped from. A dataset is loaded with TrainingSet::load(), which uses the file in
+ * place, and saved again to the same name; the saved file must then load with the same
+ * samples. A network is loaded with loadModel(), which uses the weights of the file in
+ * place too, trained some more and saved to the same model file and to the same name as
+ * XML; the saved networks must give the same outputs. The program exits with status 1
+ * if anything is lost.
+ *
+ * by BlackLight, 2009
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <neural++.hpp>
+
+using namespace std;
+using namespace neuralpp;
+
+#define	DATASET	"mappedSaveCheck.bin"
+#define	MODEL	"mappedSaveCheck.mdl"
+
+static bool datasetCheck()  {
+	TrainingSet set(3, 2);
+
+	for (size_t i = 0; i < 100; i++)  {
+		double in[3] = { i * 0.1, i * 0.2, i * 0.3 };
+		double out[2] = { i * 0.5, i * 0.7 };
+		set.add(in, out);
+	}
+
+	set.save(DATASET);
+
+	TrainingSet mapped;
+	mapped.load(DATASET);
+
+	try  {
+		mapped.save(DATASET);
+	} catch (DatasetFileWriteException& e)  {
+		cerr << "Dataset: " << e.what() << endl;
+		return false;
+	}
+
+	TrainingSet saved;
+	saved.load(DATASET);
+
+	if (saved.size() != set.size())  {
+		cerr << "Dataset: " << saved.size() << " samples saved instead of " << set.size() << endl;
+		return false;
+	}
+
+	for (size_t i = 0; i < set.size(); i++)  {
+		bool same = true;
+
+		for (size_t j = 0; j < 3; j++)
+			same &= (saved.input(i)[j] == set.input(i)[j] && mapped.input(i)[j] == set.input(i)[j]);
+
+		for (size_t j = 0; j < 2; j++)
+			same &= (saved.target(i)[j] == set.target(i)[j] && mapped.target(i)[j] == set.target(i)[j]);
+
+		if (!same)  {
+			cerr << "Dataset: sample " << i << " changed\n";
+			return false;
+		}
+	}
+
+	cout << "Dataset saved over its mapping: ok\n";
+	return true;
+}
+
+static bool modelCheck()  {
+	TrainingSet set(3, 2);
+
+	for (size_t i = 0; i < 100; i++)  {
+		double in[3] = { i * 0.01, 0.5, -0.2 };
+		double out[2] = { i * 0.005, 0.3 };
+		set.add(in, out);
+	}
+
+	NeuralNet net(3, 16, 2, 0.005, 5, 0.0, activation::sigmoid, 1);
+	net.train(set);
+	net.saveModel(MODEL);
+
+	NeuralNet mapped;
+	mapped.loadModel(MODEL);
+	mapped.train(set);
+
+	try  {
+		mapped.saveModel(MODEL);
+		mapped.save(MODEL);
+		mapped.saveModel(MODEL);
+	} catch (NetworkFileWriteException& e)  {
+		cerr << "Model: " << e.what() << endl;
+		return false;
+	}
+
+	NeuralNet saved;
+	saved.loadModel(MODEL);
+
+	double in[3] = { 0.3, 0.5, -0.2 };
+	double a[2], b[2];
+
+	mapped.setInput(in, 3);
+	mapped.propagate();
+	mapped.getOutputs(a, 2);
+	saved.setInput(in, 3);
+	saved.propagate();
+	saved.getOutputs(b, 2);
+
+	if (a[0] != b[0] || a[1] != b[1])  {
+		cerr << "Model: the saved network gives different outputs\n";
+		return false;
+	}
+
+	cout << "Model saved over its mapping: ok\n";
+	return true;
+}
+
+int main()  {
+	bool ok = datasetCheck();
+	ok &= modelCheck();
+
+	remove(DATASET);
+	remove(MODEL);
+	return (ok) ? 0 : 1;
+}
+
@@ -0,0 +1,109 @@
+/**
+ * Walk an XML training set (adder.xml by default) from several threads at once, each
+ * one through its own CMarkupCursor on a shared CMarkupDoc, and check that every
+ * thread reads the same values as a plain single-threaded CMarkup. The values are read
+ * through the numeric accessors, so nothing is copied out of the document. The program
+ * exits with status 1 if any walk disagrees.
+ *
+ * by BlackLight, 2009
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <pthread.h>
+#include <Markup.h>
+
+using namespace std;
+
+#define	THREADS	8
+#define	WALKS	200
+
+static CMarkupDoc doc;
+static string expected;
+
+/**
+ * Summary of a training set read through a single CMarkup
+ */
+static string walk (CMarkup xml)  {
+	ostringstream out;
+	double value;
+
+	xml.ResetPos();
+	xml.FindElem("network");
+	xml.IntoElem();
+
+	while (xml.FindElem("training"))  {
+		out << xml.GetAttrib("id") << ':';
+
+		while (xml.FindChildElem())  {
+			xml.GetChildDataNum(value);
+			out << xml.GetChildTagName() << '=' << value << ',';
+		}
+	}
+
+	return out.str();
+}
+
+/**
+ * The same summary read through a cursor on the shared document
+ */
+static string walk (CMarkupCursor cur)  {
+	ostringstream out;
+	double value;
+
+	cur.FindElem("network");
+	cur.IntoElem();
+
+	while (cur.FindElem("training"))  {
+		out << cur.GetAttrib("id") << ':';
+
+		while (cur.FindChildElem())  {
+			cur.GetChildDataNum(value);
+			out << cur.GetChildTagName() << '=' << value << ',';
+		}
+	}
+
+	return out.str();
+}
+
+static void* job (void *arg)  {
+	long *errors = (long*) arg;
+
+	for (int i = 0; i < WALKS; i++)
+		if (walk(CMarkupCursor(doc)) != expected)
+			(*errors)++;
+
+	return NULL;
+}
+
+int main (int argc, char **argv)  {
+	const char *file = (argc > 1) ? argv[1] : "adder.xml";
+	CMarkup xml;
+
+	if (!xml.Load(file) || !doc.Load(file))  {
+		cerr << "Could not load " << file << endl;
+		return 1;
+	}
+
+	expected = walk(xml);
+
+	pthread_t threads[THREADS];
+	long errors[THREADS];
+
+	for (int i = 0; i < THREADS; i++)  {
+		errors[i] = 0;
+		pthread_create(&threads[i], NULL, job, &errors[i]);
+	}
+
+	long total = 0;
+
+	for (int i = 0; i < THREADS; i++)  {
+		pthread_join(threads[i], NULL);
+		total += errors[i];
+	}
+
+	cout << THREADS << " threads, " << THREADS * WALKS << " walks, " << total << " mismatches\n";
+	return (total == 0 && !expected.empty()) ? 0 : 1;
+}
+
@@ -0,0 +1,221 @@
+/**
+ * Check that the vectorized scanning in CMarkup gives the same results as the plain
+ * per-character loops. Random documents, half of them corrupted, are parsed and walked
+ * node by node, and random text is passed to UnescapeText and DetectUTF8 at every
+ * alignment. Everything that is read (node types, names, data, attributes, errors) is
+ * hashed into a digest, which has to be the one of the plain loops: EXPECTED below was
+ * printed by this program linked to a library built with ARCHFLAGS=-DMARKUP_NOSIMD.
+ * The program exits with status 1 if the digest differs.
+ *
+ * by BlackLight, 2009
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <Markup.h>
+
+using namespace std;
+
+#define	DOCUMENTS	2000
+#define	TEXTS	500
+#define	EXPECTED	0x8ba93f04UL
+
+static unsigned long seed = 1;
+
+/**
+ * Small linear congruential generator, so that the documents don't depend on rand()
+ */
+static unsigned int rnd (unsigned int n)  {
+	seed = (seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+	return (unsigned int) (seed >> 8) % n;
+}
+
+static unsigned long digest = 2166136261UL;
+
+/**
+ * FNV-1a hash of everything read from the documents
+ */
+static void hash (const string& s)  {
+	for (size_t i = 0; i < s.size(); i++)
+		digest = ((digest ^ (unsigned char) s[i]) * 16777619UL) & 0xffffffffUL;
+
+	digest = ((digest ^ 0xff) * 16777619UL) & 0xffffffffUL;
+}
+
+static void hash (long n)  {
+	char buf[32];
+	sprintf(buf, "%ld", n);
+	hash(string(buf));
+}
+
+static string pick (const char *chars, size_t len)  {
+	string s;
+	size_t n = strlen(chars);
+
+	for (size_t i = 0; i < len; i++)
+		s += chars[rnd(n)];
+	return s;
+}
+
+static string name()  {
+	return pick("abcdefghijklmnopqrstuvwxyz", 1) + pick("abcdefghijklmnopqrstuvwxyz0123456789_-.", rnd(40));
+}
+
+static string space()  {
+	return pick(" \t\r\n", rnd(4) ? rnd(3) : rnd(70));
+}
+
+static string text()  {
+	const char *entities[] = { "&amp;", "&lt;", "&gt;", "&quot;", "&apos;", "&#65;", "&#x42;", "&bogus;", "&" };
+	string s;
+	size_t n = rnd(8);
+
+	for (size_t i = 0; i < n; i++)  {
+		s += pick("0123456789.-e ", rnd(4) ? rnd(20) : rnd(200));
+
+		if (!rnd(3))
+			s += entities[rnd(9)];
+		else if (!rnd(8))
+			s += pick("\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\xff\x80", 1 + rnd(4));
+	}
+
+	return s;
+}
+
+static string element (int depth)  {
+	string tag = name();
+	string s = "<" + tag;
+	size_t attribs = rnd(4);
+
+	for (size_t i = 0; i < attribs; i++)  {
+		char quote = rnd(2) ? '"' : '\'';
+		s += " " + space() + name() + space() + "=" + space() + quote + text() + quote;
+	}
+
+	s += space();
+
+	if (!rnd(5))
+		return s + "/>";
+
+	s += ">";
+	size_t nodes = (depth < 5) ? rnd(6) : 0;
+
+	for (size_t i = 0; i < nodes; i++)  {
+		switch (rnd(7))  {
+			case 0:
+				s += "<!--" + pick("abc ->\n", rnd(100)) + "-->";
+				break;
+			case 1:
+				s += "<![CDATA[" + pick("<>]&abc \n", rnd(100)) + "]]>";
+				break;
+			case 2:
+				s += "<?" + name() + " " + pick("abc =\"?", rnd(50)) + "?>";
+				break;
+			case 3:
+				s += space();
+				break;
+			case 4:
+				s += text();
+				break;
+			default:
+				s += element(depth + 1);
+		}
+	}
+
+	return s + "</" + tag + space() + ">";
+}
+
+/**
+ * Corrupt a document deleting, inserting or cutting some of its characters
+ */
+static string corrupt (string s)  {
+	size_t n = 1 + rnd(4);
+
+	for (size_t i = 0; i < n && !s.empty(); i++)  {
+		size_t at = rnd(s.size());
+
+		switch (rnd(3))  {
+			case 0:
+				s.erase(at, 1 + rnd(10));
+				break;
+			case 1:
+				s.insert(at, pick("<>/&\"' =![]-?", 1 + rnd(3)));
+				break;
+			default:
+				s.erase(at + rnd(s.size() - at));
+		}
+	}
+
+	return s;
+}
+
+static void walk (CMarkup& xml, int depth)  {
+	int type;
+
+	while ((type = xml.FindNode()))  {
+		hash(type);
+		hash(xml.GetTagName());
+		hash(xml.GetData());
+
+		if (type != CMarkup::MNT_ELEMENT)
+			continue;
+
+		for (int n = 0; ; n++)  {
+			string attrib = xml.GetAttribName(n);
+
+			if (attrib.empty())
+				break;
+
+			hash(attrib);
+			hash(xml.GetAttrib(attrib));
+		}
+
+		if (depth < 16 && xml.IntoElem())  {
+			walk(xml, depth + 1);
+			xml.OutOfElem();
+		}
+	}
+}
+
+int main()  {
+	for (size_t i = 0; i < DOCUMENTS; i++)  {
+		string doc = "<?xml version=\"1.0\"?>" + space() + element(0) + space();
+		CMarkup xml;
+
+		if (i % 2)
+			doc = corrupt(doc);
+
+		hash(xml.SetDoc(doc));
+		hash(xml.GetError());
+		walk(xml, 0);
+	}
+
+	// Start the text at every offset from a vector boundary, and cut it at every length
+	// around the end, so that the tails are read both in vectors and one at a time
+	for (size_t i = 0; i < TEXTS; i++)  {
+		char buf[4096];
+		string t = text() + text();
+
+		if (t.size() > sizeof(buf) - 64)
+			t.resize(sizeof(buf) - 64);
+
+		for (size_t off = 0; off < 64; off++)  {
+			memset(buf, '#', sizeof(buf));
+			memcpy(buf + off, t.data(), t.size());
+
+			for (size_t cut = 0; cut < 40 && cut <= t.size(); cut++)  {
+				int len = (int) (t.size() - cut);
+				int non_ascii = 0;
+
+				hash(CMarkup::UnescapeText(buf + off, len));
+				hash(CMarkup::DetectUTF8(buf + off, len, &non_ascii));
+				hash(non_ascii);
+			}
+		}
+	}
+
+	printf("Digest %08lx, expected %08lx\n", digest, (unsigned long) EXPECTED);
+	return (digest == EXPECTED) ? 0 : 1;
+}
+
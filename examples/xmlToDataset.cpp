@@ -0,0 +1,45 @@
+/**
+ * Convert an XML training set (like adder.xml) to a binary dataset file, which can then be
+ * loaded (mapped in memory) through TrainingSet::load() and passed to NeuralNet::train()
+ * without parsing anything. The values are saved as double, or as float if -f is given.
+ *
+ * by BlackLight, 2009
+ */
+
+#include <iostream>
+#include <cstring>
+#include <neural++.hpp>
+
+using namespace std;
+using namespace neuralpp;
+
+int main (int argc, char **argv)  {
+	bool single = (argc == 4 && !strcmp(argv[1], "-f"));
+
+	if (argc != 3 && !single)  {
+		cerr << "Usage: " << argv[0] << " [-f] <training.xml> <dataset file>\n";
+		return 1;
+	}
+
+	TrainingSet set;
+
+	try  {
+		if (single)
+			FloatTrainingSet::convert(argv[2], argv[3]);
+		else
+			TrainingSet::convert(argv[1], argv[2]);
+
+		set.load(argv[argc-1]);
+	}
+
+	catch (exception& e)  {
+		cerr << "Fatal error: " << e.what() << endl;
+		return 1;
+	}
+
+	cout << set.size() << " samples (" << set.inputSize() << " inputs, "
+		<< set.outputSize() << " outputs) written to " << argv[argc-1] << endl;
+
+	return 0;
+}
+
@@ -11,6 +11,7 @@
 
 #include <stdlib.h>
 #include <string.h> // memcpy, memset, strcmp...
+#include <stdio.h> // sprintf
 
 // Major build options
 // MARKUP_WCHAR wide char (2-byte UTF-16 on Windows, 4-byte UTF-32 on Linux and OS X)
@@ -67,6 +68,7 @@
 #define MCD_PSZCHR wcschr
 #define MCD_PSZSTR wcsstr
 #define MCD_PSZTOL wcstol
+#define MCD_PSZTOD wcstod
 #define MCD_PSZNCMP wcsncmp
 #if defined(MARKUP_SAFESTR) // VC++ safe strings
 #define MCD_SSZ(sz) sz,(sizeof(sz)/sizeof(MCD_CHAR))
@@ -101,6 +103,7 @@
 #define MCD_PSZCHR strchr
 #define MCD_PSZSTR strstr
 #define MCD_PSZTOL strtol
+#define MCD_PSZTOD strtod
 #define MCD_PSZNCMP strncmp
 #if defined(MARKUP_SAFESTR) // VC++ safe strings
 #define MCD_SSZ(sz) sz,(sizeof(sz)/sizeof(MCD_CHAR))
@@ -191,6 +194,18 @@ struct MCD_CSTR
 	MCD_PCSZ pcsz;
 };
 
+// Non-allocating view of text inside the document, filled in by the Get*View methods
+// The text is not null terminated; if bEscaped is set it contains entity references
+// and must go through CMarkup::UnescapeText before use
+// A view is valid until the document is modified
+struct MCD_STRVIEW
+{
+	MCD_STRVIEW() { pcsz=NULL; nLength=0; bEscaped=false; };
+	MCD_PCSZ pcsz;
+	int nLength;
+	bool bEscaped;
+};
+
 // On Linux and OS X, filenames are not specified in wchar_t
 #if defined(MARKUP_WCHAR) && defined(__GNUC__)
 #undef MCD_FOPEN
@@ -232,7 +247,7 @@ public:
 	bool Load( MCD_CSTR_FILENAME szFileName );
 	bool SetDoc( MCD_PCSZ pDoc );
 	bool SetDoc( const MCD_STR& strDoc );
-	bool IsWellFormed();
+	bool IsWellFormed() const;
 	bool FindElem( MCD_CSTR szName=NULL );
 	bool FindChildElem( MCD_CSTR szName=NULL );
 	bool IntoElem();
@@ -248,6 +263,23 @@ public:
 	MCD_STR GetAttrib( MCD_CSTR szAttrib ) const { return x_GetAttrib(m_iPos,szAttrib); };
 	MCD_STR GetChildAttrib( MCD_CSTR szAttrib ) const { return x_GetAttrib(m_iPosChild,szAttrib); };
 	MCD_STR GetAttribName( int n ) const;
+	// Non-allocating accessors, for reading large documents: the *View methods point an
+	// MCD_STRVIEW into the document text, the *Num methods parse a double or an int in place
+	// Both return false when there is no such value (or, for *Num, when it is not a number)
+	bool GetTagNameView( MCD_STRVIEW& view ) const { return m_nNodeLength ? false : x_GetTagNameView(m_iPos,view); };
+	bool GetChildTagNameView( MCD_STRVIEW& view ) const { return x_GetTagNameView(m_iPosChild,view); };
+	bool GetDataView( MCD_STRVIEW& view ) const { return x_GetDataView(m_iPos,view); };
+	bool GetChildDataView( MCD_STRVIEW& view ) const { return x_GetElemDataView(m_iPosChild,view); };
+	bool GetAttribView( MCD_CSTR szAttrib, MCD_STRVIEW& view ) const { return (m_nNodeType==MNT_ELEMENT) ? x_GetElemAttribView(m_iPos,szAttrib,view) : false; };
+	bool GetChildAttribView( MCD_CSTR szAttrib, MCD_STRVIEW& view ) const { return (m_nNodeType==MNT_ELEMENT) ? x_GetElemAttribView(m_iPosChild,szAttrib,view) : false; };
+	bool GetDataNum( double& dValue ) const { MCD_STRVIEW v; return x_GetDataView(m_iPos,v) ? x_ViewToNum(v,dValue) : x_StrToNum(GetData(),dValue); };
+	bool GetDataNum( int& nValue ) const { MCD_STRVIEW v; return x_GetDataView(m_iPos,v) ? x_ViewToNum(v,nValue) : x_StrToNum(GetData(),nValue); };
+	bool GetChildDataNum( double& dValue ) const { MCD_STRVIEW v; return x_GetElemDataView(m_iPosChild,v) ? x_ViewToNum(v,dValue) : x_StrToNum(GetChildData(),dValue); };
+	bool GetChildDataNum( int& nValue ) const { MCD_STRVIEW v; return x_GetElemDataView(m_iPosChild,v) ? x_ViewToNum(v,nValue) : x_StrToNum(GetChildData(),nValue); };
+	bool GetAttribNum( MCD_CSTR szAttrib, double& dValue ) const { MCD_STRVIEW v; return GetAttribView(szAttrib,v) && x_ViewToNum(v,dValue); };
+	bool GetAttribNum( MCD_CSTR szAttrib, int& nValue ) const { MCD_STRVIEW v; return GetAttribView(szAttrib,v) && x_ViewToNum(v,nValue); };
+	bool GetChildAttribNum( MCD_CSTR szAttrib, double& dValue ) const { MCD_STRVIEW v; return GetChildAttribView(szAttrib,v) && x_ViewToNum(v,dValue); };
+	bool GetChildAttribNum( MCD_CSTR szAttrib, int& nValue ) const { MCD_STRVIEW v; return GetChildAttribView(szAttrib,v) && x_ViewToNum(v,nValue); };
 	int FindNode( int nType=0 );
 	int GetNodeType() { return m_nNodeType; };
 	bool SavePos( MCD_CSTR szPosName=MCD_T(""), int nMap = 0 );
@@ -346,6 +378,7 @@ public:
 	static MCD_STR GetDeclaredEncoding( MCD_CSTR szDoc );
 
 protected:
+	friend class CMarkupCursor;
 
 #if defined(_DEBUG)
 	MCD_PCSZ m_pMainDS;
@@ -594,7 +627,17 @@ protected:
 	MCD_STR x_GetPath( int iPos ) const;
 	MCD_STR x_GetTagName( int iPos ) const;
 	MCD_STR x_GetData( int iPos ) const;
+	MCD_STR x_GetElemData( int iPos ) const;
 	MCD_STR x_GetAttrib( int iPos, MCD_PCSZ pAttrib ) const;
+	MCD_STR x_GetElemAttrib( int iPos, MCD_PCSZ pAttrib ) const;
+	bool x_GetTagNameView( int iPos, MCD_STRVIEW& view ) const;
+	bool x_GetDataView( int iPos, MCD_STRVIEW& view ) const;
+	bool x_GetElemDataView( int iPos, MCD_STRVIEW& view ) const;
+	bool x_GetElemAttribView( int iPos, MCD_PCSZ pAttrib, MCD_STRVIEW& view ) const;
+	static bool x_ViewToNum( const MCD_STRVIEW& view, double& dValue );
+	static bool x_ViewToNum( const MCD_STRVIEW& view, int& nValue );
+	static bool x_StrToNum( const MCD_STR& str, double& dValue ) { MCD_STRVIEW v; v.pcsz=MCD_2PCSZ(str); v.nLength=MCD_STRLENGTH(str); return x_ViewToNum(v,dValue); };
+	static bool x_StrToNum( const MCD_STR& str, int& nValue ) { MCD_STRVIEW v; v.pcsz=MCD_2PCSZ(str); v.nLength=MCD_STRLENGTH(str); return x_ViewToNum(v,nValue); };
 	static MCD_STR x_EncodeCDATASection( MCD_PCSZ szData );
 	bool x_AddElem( MCD_PCSZ pName, MCD_PCSZ pValue, int nFlags );
 	bool x_AddElem( MCD_PCSZ pName, int nValue, int nFlags );
@@ -642,4 +685,79 @@ protected:
 	static MCD_STR x_IntToStr( int n ) { MCD_CHAR sz[25]; MCD_SPRINTF(MCD_SSZ(sz),MCD_T("%d"),n); MCD_STR s=sz; return s; };
 };
 
+// CMarkupDoc is a parsed document that cannot be modified once loaded
+// It keeps no navigation state, so any number of CMarkupCursor objects in any
+// number of threads can walk it at the same time without locking
+// Load and SetDoc replace the document and must not run while cursors are in use
+class CMarkupDoc
+{
+public:
+	CMarkupDoc() {};
+	CMarkupDoc( MCD_CSTR szDoc ) { SetDoc( szDoc ); };
+	CMarkupDoc( const CMarkup& markup ) { m_markup = markup; m_markup.ResetPos(); };
+
+	bool Load( MCD_CSTR_FILENAME szFileName ) { return m_markup.Load( szFileName ); };
+	bool SetDoc( MCD_PCSZ pDoc ) { return m_markup.SetDoc( pDoc ); };
+	bool SetDoc( const MCD_STR& strDoc ) { return m_markup.SetDoc( strDoc ); };
+	bool IsWellFormed() const { return m_markup.IsWellFormed(); };
+	const MCD_STR& GetDoc() const { return m_markup.GetDoc(); };
+	const MCD_STR& GetError() const { return m_markup.GetError(); };
+	int GetDocFlags() const { return m_markup.GetDocFlags(); };
+
+protected:
+	friend class CMarkupCursor;
+	CMarkup m_markup;
+
+private:
+	CMarkupDoc( const CMarkupDoc& );
+	void operator=( const CMarkupDoc& );
+};
+
+// CMarkupCursor is a lightweight position in a CMarkupDoc
+// It offers the element navigation and read methods of CMarkup, keeping the
+// parent, main and child positions in the cursor instead of in the document
+// Cursors are copyable, so a position can be handed to another thread as is
+class CMarkupCursor
+{
+public:
+	CMarkupCursor( const CMarkupDoc& doc ) { m_pMarkup = &doc.m_markup; ResetPos(); };
+
+	bool FindElem( MCD_CSTR szName=NULL );
+	bool FindChildElem( MCD_CSTR szName=NULL );
+	bool IntoElem();
+	bool OutOfElem();
+	void ResetChildPos() { m_iPosChild = 0; };
+	void ResetMainPos() { m_iPos = 0; m_iPosChild = 0; };
+	void ResetPos() { m_iPosParent = 0; m_iPos = 0; m_iPosChild = 0; };
+	MCD_STR GetTagName() const { return m_iPos ? m_pMarkup->x_GetTagName(m_iPos) : MCD_STR(); };
+	MCD_STR GetChildTagName() const { return m_iPosChild ? m_pMarkup->x_GetTagName(m_iPosChild) : MCD_STR(); };
+	MCD_STR GetData() const { return m_iPos ? m_pMarkup->x_GetElemData(m_iPos) : MCD_STR(); };
+	MCD_STR GetChildData() const { return m_iPosChild ? m_pMarkup->x_GetElemData(m_iPosChild) : MCD_STR(); };
+	MCD_STR GetElemContent() const { return m_pMarkup->x_GetElemContent(m_iPos); };
+	MCD_STR GetAttrib( MCD_CSTR szAttrib ) const { return m_pMarkup->x_GetElemAttrib(m_iPos,szAttrib); };
+	MCD_STR GetChildAttrib( MCD_CSTR szAttrib ) const { return m_pMarkup->x_GetElemAttrib(m_iPosChild,szAttrib); };
+	MCD_STR GetSubDoc() const { return m_pMarkup->x_GetSubDoc(m_iPos); };
+	MCD_STR GetChildSubDoc() const { return m_pMarkup->x_GetSubDoc(m_iPosChild); };
+	bool GetTagNameView( MCD_STRVIEW& view ) const { return m_pMarkup->x_GetTagNameView(m_iPos,view); };
+	bool GetChildTagNameView( MCD_STRVIEW& view ) const { return m_pMarkup->x_GetTagNameView(m_iPosChild,view); };
+	bool GetDataView( MCD_STRVIEW& view ) const { return m_pMarkup->x_GetElemDataView(m_iPos,view); };
+	bool GetChildDataView( MCD_STRVIEW& view ) const { return m_pMarkup->x_GetElemDataView(m_iPosChild,view); };
+	bool GetAttribView( MCD_CSTR szAttrib, MCD_STRVIEW& view ) const { return m_pMarkup->x_GetElemAttribView(m_iPos,szAttrib,view); };
+	bool GetChildAttribView( MCD_CSTR szAttrib, MCD_STRVIEW& view ) const { return m_pMarkup->x_GetElemAttribView(m_iPosChild,szAttrib,view); };
+	bool GetDataNum( double& dValue ) const { MCD_STRVIEW v; return GetDataView(v) ? CMarkup::x_ViewToNum(v,dValue) : CMarkup::x_StrToNum(GetData(),dValue); };
+	bool GetDataNum( int& nValue ) const { MCD_STRVIEW v; return GetDataView(v) ? CMarkup::x_ViewToNum(v,nValue) : CMarkup::x_StrToNum(GetData(),nValue); };
+	bool GetChildDataNum( double& dValue ) const { MCD_STRVIEW v; return GetChildDataView(v) ? CMarkup::x_ViewToNum(v,dValue) : CMarkup::x_StrToNum(GetChildData(),dValue); };
+	bool GetChildDataNum( int& nValue ) const { MCD_STRVIEW v; return GetChildDataView(v) ? CMarkup::x_ViewToNum(v,nValue) : CMarkup::x_StrToNum(GetChildData(),nValue); };
+	bool GetAttribNum( MCD_CSTR szAttrib, double& dValue ) const { MCD_STRVIEW v; return GetAttribView(szAttrib,v) && CMarkup::x_ViewToNum(v,dValue); };
+	bool GetAttribNum( MCD_CSTR szAttrib, int& nValue ) const { MCD_STRVIEW v; return GetAttribView(szAttrib,v) && CMarkup::x_ViewToNum(v,nValue); };
+	bool GetChildAttribNum( MCD_CSTR szAttrib, double& dValue ) const { MCD_STRVIEW v; return GetChildAttribView(szAttrib,v) && CMarkup::x_ViewToNum(v,dValue); };
+	bool GetChildAttribNum( MCD_CSTR szAttrib, int& nValue ) const { MCD_STRVIEW v; return GetChildAttribView(szAttrib,v) && CMarkup::x_ViewToNum(v,nValue); };
+
+protected:
+	const CMarkup* m_pMarkup;
+	int m_iPosParent;
+	int m_iPos;
+	int m_iPosChild;
+};
+
 #endif // !defined(_MARKUP_H_INCLUDED_)
@@ -16,7 +16,9 @@
 
 #include <vector>
 #include <string>
+#include <iosfwd>
 #include <cmath>
+#include <stdint.h>
 
 #include "neural++_exception.hpp"
 
@@ -28,17 +30,128 @@
  * @brief Main namespace for the library
  */
 namespace neuralpp  {
-	class Synapsis;
-	class Neuron;
-	class Layer;
-	class NeuralNet;
+	template <typename T> class BasicSynapsis;
+	template <typename T> class BasicNeuron;
+	template <typename T> class BasicLayer;
+	template <typename T> class BasicNeuralNet;
+	template <typename T> class BasicTrainingSet;
+	class QuantizedNeuralNet;
+	class ThreadPool;
+	class Arena;
+	class MappedFile;
 
 	double df (double (*f)(double), double x);
 	double __actv(double prop);
 
 	/**
-	 * @class NeuralNet
-	 * @brief Main project's class. Use *ONLY* this class, unless you know what you're doing
+	 * @namespace neuralpp::activation
+	 * @brief Ready-to-use activation functions, each one paired with its closed-form
+	 *  derivative. Any other function can still be used as activation function, but its
+	 *  derivative will be computed numerically through df()
+	 */
+	namespace activation  {
+		/**
+		 * @brief Derivative of an activation function
+		 * @param x Point where the derivative is computed (propagation value)
+		 * @param fx Value of the activation function in x (activation value)
+		 * @return Value of the derivative in x
+		 */
+		typedef double (*derivative_f)(double x, double fx);
+
+		/**
+		 * @brief Activation function
+		 */
+		typedef double (*function)(double x);
+
+		/**
+		 * @brief Slope of leakyRelu() for negative values
+		 */
+		static const double LEAKY_SLOPE = 0.01;
+
+		/**
+		 * @brief Identity function, f(x) = x (same as the default activation function)
+		 */
+		double identity (double x);
+
+		/**
+		 * @brief Logistic sigmoid, f(x) = 1 / (1 + e^-x)
+		 */
+		double sigmoid (double x);
+
+		/**
+		 * @brief Hyperbolic tangent
+		 */
+		double tanh (double x);
+
+		/**
+		 * @brief Rectified linear unit, f(x) = max(0, x)
+		 */
+		double relu (double x);
+
+		/**
+		 * @brief Leaky rectified linear unit, f(x) = x if x > 0, LEAKY_SLOPE * x otherwise
+		 */
+		double leakyRelu (double x);
+
+		/**
+		 * @brief Softplus, f(x) = ln(1 + e^x)
+		 */
+		double softplus (double x);
+
+		/**
+		 * @brief Get the closed-form derivative of an activation function
+		 * @param f Activation function
+		 * @return The derivative of f, or NULL if f is not one of the known functions
+		 *  (in that case its derivative should be computed numerically through df())
+		 */
+		derivative_f derivative (double (*f)(double));
+	}
+
+	/**
+	 * @class Random
+	 * @brief Fast pseudo-random number generator (xoshiro128**) used to initialize the
+	 *  weights of the networks. Each network draws its weights from a generator of its own,
+	 *  so networks can be built concurrently, and building twice a network with the same
+	 *  seed gives the same weights
+	 */
+	class Random  {
+		uint32_t s[4];
+
+	public:
+		/**
+		 * @brief Constructor
+		 * @param seed Seed of the generator
+		 */
+		Random (uint32_t seed);
+
+		/**
+		 * @brief Restart the sequence of the generator from a new seed
+		 * @param seed Seed of the generator
+		 */
+		void seed (uint32_t seed);
+
+		/**
+		 * @return Next 32-bit pseudo-random number
+		 */
+		uint32_t next();
+
+		/**
+		 * @return Pseudo-random number uniformly distributed in [0,1), with 53 random bits
+		 */
+		double uniform();
+
+		/**
+		 * @brief Get a seed that changes at each call, for when no seed has been given
+		 * @return A seed taken from the clock and from a counter
+		 */
+		static uint32_t timeSeed();
+	};
+
+	/**
+	 * @class BasicNeuralNet
+	 * @brief Main project's class. Use *ONLY* this class, unless you know what you're doing.
+	 *  It's templated on the type T of the real numbers the network operates on: use it
+	 *  through its NeuralNet (double) and FloatNeuralNet (float) instances
 	 *
 	 * @example examples/learnAdd.cpp Show how to train a network that performs sums between
 	 * two real numbers. The training XML is built from scratch, then saved to a file, then
@@ -64,12 +177,66 @@ namespace neuralpp  {
 	 * sum and difference (so the network provides two output values). The training set is
 	 * auto-generated to an XML string, and then the network is trained.
 	 */
-	class NeuralNet  {
+	template <typename T>
+	class BasicNeuralNet  {
+		typedef BasicLayer<T> Layer;
+
 		int epochs;
 		int ref_epochs;
-		double l_rate;
-		double threshold;
-		std::vector<double> expect;
+		size_t batch_size;
+		size_t train_threads;
+		bool train_sync;
+		size_t fwd_threads;
+		size_t par_size;
+		ThreadPool *pool;
+		Arena *arena;
+		MappedFile *model;
+		T l_rate;
+		T threshold;
+		std::vector<T> expect;
+
+		/**
+		 * @brief Build the layers of the network, dropping the previous ones. The layers,
+		 *   their neurons and all their buffers are drawn from the arena of the network,
+		 *   in a single block. In-class use only
+		 */
+		void init (size_t in_size, size_t hidden_size, size_t out_size, T l,
+				int e, T th, double (*a)(double), uint32_t seed = 0);
+
+		/**
+		 * @brief Build the layers of the network like init(), but leave them unlinked,
+		 *   for the caller to give them their weights. In-class use only
+		 * @param weights Whether the weights will be drawn from the arena too
+		 */
+		void build (size_t in_size, size_t hidden_size, size_t out_size, T l,
+				int e, T th, double (*a)(double), bool weights);
+
+		/**
+		 * @brief Build the layers of the network like init(), with all the weights set
+		 *   to zero. In-class use only
+		 */
+		void buildZero (size_t in_size, size_t hidden_size, size_t out_size, T l, int e, T th);
+
+		/**
+		 * @brief Load the network from the text of an XML network file, scanning it once
+		 *   and writing each weight straight into the weight matrices. In-class use only
+		 * @param p Start of the text
+		 * @param end End of the text
+		 * @throw InvalidXMLException
+		 */
+		void loadXML (const char *p, const char *end) throw(InvalidXMLException);
+
+		/**
+		 * @brief Create the thread pool of the parallel forward pass as set through
+		 *   setThreads(), and hand it to the layers. In-class use only
+		 */
+		void applyThreads();
+
+		/**
+		 * @brief Destroy the layers and the thread pool of the network, release its
+		 *   arena in one shot and unmap its model file, if any. In-class use only
+		 */
+		void destroy();
 
 		/**
 		 * @brief It updates the weights of the net's synapsis through back-propagation.
@@ -77,12 +244,61 @@ namespace neuralpp  {
 		 */
 		void updateWeights();
 
+		/**
+		 * @brief Compute through back-propagation the gradient of the error on the
+		 *   current sample, and add it to the delta buffers of the synapsis. In-class use only
+		 */
+		void accumulateGradients();
+
+		/**
+		 * @brief Compute through back-propagation the gradient of the error on a sample
+		 *   and add it to the given buffers, leaving the state of the network untouched
+		 * @param x Activation values of the input layer
+		 * @param hprop Propagation values of the hidden layer
+		 * @param hactv Activation values of the hidden layer
+		 * @param oprop Propagation values of the output layer
+		 * @param oactv Activation values of the output layer
+		 * @param ex Expected output values
+		 * @param gout Gradient of the weights of the output layer, same layout as its weights
+		 * @param ghid Gradient of the weights of the hidden layer, same layout as its weights
+		 */
+		void backPropagate (const T *x, const T *hprop, const T *hactv,
+				const T *oprop, const T *oactv, const T *ex,
+				T *gout, T *ghid) const;
+
+		/**
+		 * @brief Update the weights of the synapsis using the gradients accumulated so far
+		 * @param n Number of samples the gradients were accumulated on
+		 * @param inertial Whether to apply the inertial momentum of the synapsis
+		 */
+		void applyGradients (size_t n, bool inertial);
+
+		/**
+		 * @brief Mini-batch training: each epoch is a pass over the whole training set, and
+		 *   the weights are updated once for each batch of samples
+		 * @param set Training set
+		 */
+		void updateBatches (const BasicTrainingSet<T>& set);
+
+		/**
+		 * @brief Parallel training: each epoch is a pass over the whole training set, split
+		 *   across the training threads, either updating the shared weights without any lock
+		 *   (Hogwild) or averaging the gradients of the threads on each batch
+		 * @param set Training set
+		 */
+		void updateParallel (const BasicTrainingSet<T>& set);
+
+		/**
+		 * @brief Job run by each thread in parallel training
+		 */
+		static void trainJob (void *arg, size_t part, size_t parts);
+
 		/**
 		 * @brief Get the error made on the expected result as squared deviance
 		 * @param ex Expected value
 		 * @return Mean error
 		 */
-		double error (double ex);
+		T error (T ex);
 		
 		/**
 		 * @brief Private pointer to function, containing the function to
@@ -90,31 +306,53 @@ namespace neuralpp  {
 		 */
 		double (*actv_f)(double);
 
+		/**
+		 * @brief Closed-form derivative of the activation function, or NULL if it's not
+		 * known and has to be computed numerically
+		 */
+		activation::derivative_f actv_df;
+
+		/**
+		 * @brief Derivative of the activation function in a point
+		 * @param x Propagation value of a neuron
+		 * @param fx Activation value of the neuron
+		 * @return Value of the derivative
+		 */
+		double deriv (double x, double fx) const;
+
 		/**
 		 * @brief Get the expected value (in case you have an only neuron in output layer).  Of course you should specify this when you
 		 * build your network by using setExpected.
 		 * @return The expected output value for a certain training phase
 		 */
-		double expected() const;
+		T expected() const;
 
 		/**
 		 * @brief Get the expected value (in case you have an only neuron in output layer).  Of course you should specify this when you
 		 * build your network by using setExpected.
 		 * @return The expected output value for a certain training phase
 		 */
-		std::vector<double> getExpected() const;
+		std::vector<T> getExpected() const;
 
 		/**
 		 * @brief It sets the value you expect from your network (in case the network has an only neuron in its output layer)
 		 * @param ex Expected output value
 		 */
-		void setExpected(double ex);
+		void setExpected(T ex);
 
 		/**
 		 * @brief Set the values you expect from your network
 		 * @param ex Expected output values
 		 */
-		void setExpected(std::vector<double> ex);
+		void setExpected(std::vector<T> ex);
+
+		/**
+		 * @brief Set the values you expect from your network from a buffer. Missing
+		 *   values are set to zero
+		 * @param ex Expected output values
+		 * @param n Number of values in ex
+		 */
+		void setExpected (const T *ex, size_t n);
 
 		/**
 		 * @brief It updates through back-propagation the weights of the synapsis and
@@ -125,8 +363,9 @@ namespace neuralpp  {
 
 		/**
 		 * @brief It links the layers of the network (input, hidden, output)
+		 * @param rng Generator of the initial weights
 		 */
-		void link();
+		void link (Random& rng);
 		
 	public:
 		Layer* input;
@@ -138,10 +377,25 @@ namespace neuralpp  {
 		 */
 		typedef enum  { file, str } source;
 
+		/**
+		 * @brief Enum to choose how the threads update the weights in parallel training:
+		 *   <i>hogwild</i> lets each thread update the shared weights after each sample
+		 *   without any locking, <i>synchronous</i> averages the gradients computed by
+		 *   all the threads on a batch and updates the weights once, deterministically
+		 */
+		typedef enum  { hogwild, synchronous } training_mode;
+
+		/**
+		 * @brief Enum telling why the last training stopped: it ran all its
+		 *   <i>epochs</i>, the error reached the target set by setTargetError(), it
+		 *   stopped improving (see setPatience()), or it ran out of time (see setTimeLimit())
+		 */
+		typedef enum  { max_epochs, target_error, no_improvement, time_limit } stop_reason;
+
 		/**
 		 * @brief Empty constructor for the class - it just makes nothing
 		 */
-		NeuralNet()  {}
+		BasicNeuralNet();
 
 		/**
 		 * @brief Constructor
@@ -154,36 +408,152 @@ namespace neuralpp  {
 		 *   can be accurate for its purpose)
 		 * @param th Threshold, value in [0,1] that establishes how much a neuron must be
 		 *   'sensitive' on variations of the input values
-		 * @param a Activation function to use (default: f(x)=x)
+		 * @param a Activation function to use (default: activation::identity, f(x)=x).
+		 *   The functions in neuralpp::activation come with their closed-form derivative,
+		 *   so they make the training faster and more stable than any other function
+		 * @param seed Seed of the generator of the initial weights: the same seed always
+		 *   gives the same network (default: 0, take a new seed from the clock)
 		 */
-		NeuralNet (size_t in_size, size_t hidden_size, size_t out_size, double l,
-				int e, double th = 0.0, double (*a)(double) = __actv);
+		BasicNeuralNet (size_t in_size, size_t hidden_size, size_t out_size, T l,
+				int e, T th = 0.0, double (*a)(double) = activation::identity, uint32_t seed = 0);
 
 		/**
 		 * @brief Constructor
-		 * @param file Binary file containing a neural network previously saved by save() method
-		 * @throw NetworkFileNotFoundException
+		 * @param file XML file containing a neural network previously saved by save() method
+		 * @throw NetworkFileNotFoundException If the file can't be opened
+		 * @throw InvalidXMLException If the file is not a valid network
+		 */
+		BasicNeuralNet (const std::string file)
+			throw(NetworkFileNotFoundException, InvalidXMLException);
+
+		/**
+		 * @brief Copy constructor. The new network gets its own copy of the layers,
+		 *   of the weights and of the training state of the original one
+		 * @param net Network to copy
 		 */
-		NeuralNet (const std::string file) throw(NetworkFileNotFoundException);
+		BasicNeuralNet (const BasicNeuralNet& net);
+
+		~BasicNeuralNet();
+
+		/**
+		 * @brief Assignment operator. The previous layers of the network are released,
+		 *   and replaced by a copy of the ones of <i>net</i>
+		 * @param net Network to copy
+		 * @return Reference to this network
+		 */
+		BasicNeuralNet& operator= (const BasicNeuralNet& net);
 		
 		/**
 		 * @brief It gets the output of the network (note: the layer output should contain
 		 * an only neuron)
 		 * @return The output value of the network
 		 */
-		double getOutput() const;
+		T getOutput() const;
 
 		/**
 		 * @brief It gets the output of the network in case the output layer contains more neurons
 		 * @return A vector containing the output values of the network
 		 */
-		std::vector<double> getOutputs();
+		std::vector<T> getOutputs();
+
+		/**
+		 * @brief It copies the output values of the network into a buffer owned by the
+		 *   caller, without allocating any memory
+		 * @param out Buffer that will contain the output values
+		 * @param n Size of the buffer
+		 * @return Number of values copied, i.e. the smallest between n and the size of
+		 *   the output layer
+		 */
+		size_t getOutputs (T *out, size_t n) const;
+
+		/**
+		 * @brief Set the size of the batches for mini-batch training. When it is set, each
+		 *   epoch of train() is a pass over the whole training set, and the weights are
+		 *   updated once per batch of samples with the average of their gradients, instead
+		 *   of running all the epochs on each single sample
+		 * @param n Number of samples per batch (0, the default, to disable mini-batch training)
+		 */
+		void setBatchSize (size_t n);
+
+		/**
+		 * @brief Enable the parallel forward pass: the neurons of the layers having at least
+		 *   <i>min_size</i> neurons are split across a pool of persistent worker threads,
+		 *   while smaller layers, where the synchronization would cost more than the work
+		 *   itself, are still propagated by the calling thread
+		 * @param n Number of threads to use (0 to use all the available cores, 1 to go
+		 *   back to the single-threaded forward pass)
+		 * @param min_size Minimum number of neurons a layer should have to be propagated
+		 *   in parallel
+		 *
+		 * The setting belongs to the network object, not to its layers: it can be given
+		 *   before the network is built or loaded, and it is kept when the network is
+		 *   loaded again from a file
+		 */
+		void setThreads (size_t n, size_t min_size = 1024);
+
+		/**
+		 * @brief Train the network using several threads. As in mini-batch training, each
+		 *   epoch of train() becomes a pass over the whole training set, whose samples are
+		 *   split across the threads. In synchronous mode the weights are updated once per
+		 *   batch (see setBatchSize(), default: one sample per thread)
+		 * @param n Number of threads (0 to use all the available cores, 1 to go back to
+		 *   single-threaded training)
+		 * @param mode Either hogwild (lock-free updates, default) or synchronous
+		 */
+		void setTrainingThreads (size_t n, training_mode mode = hogwild);
+
+		/**
+		 * @brief Stop training as soon as the error of an epoch gets down to a target.
+		 *   The error of an epoch is the squared deviance of the outputs, averaged over the
+		 *   training set in mini-batch and parallel training, or on the current sample
+		 *   otherwise, and it's measured during the forward pass, so it costs nothing
+		 * @param e Target error (0, the default, to disable this criterion)
+		 */
+		void setTargetError (T e);
+
+		/**
+		 * @brief Stop training when the error hasn't improved for a number of epochs
+		 * @param epochs Number of epochs without improvement after which training stops
+		 *   (0, the default, to disable this criterion)
+		 * @param min_improvement Minimum relative decrease of the error, with respect to
+		 *   the best error so far, for an epoch to count as an improvement
+		 */
+		void setPatience (size_t epochs, T min_improvement = 0.0);
+
+		/**
+		 * @brief Stop training after some wall-clock time. It applies to each call to
+		 *   train() as a whole: in single-sample training, the remaining samples are skipped
+		 * @param seconds Maximum time in seconds (0, the default, for no limit)
+		 */
+		void setTimeLimit (double seconds);
+
+		/**
+		 * @brief Get the reason why the last training stopped (in single-sample training,
+		 *   the last sample's one)
+		 * @return Reason why the last training stopped
+		 */
+		stop_reason getStopReason() const;
+
+		/**
+		 * @brief Get the number of epochs run by the last call to train() (summed over all
+		 *   the samples in single-sample training)
+		 * @return Number of epochs run
+		 */
+		size_t getTrainedEpochs() const;
 
 		/**
 		 * @brief Get the threshold of the neurons in the network
 		 * @return The threshold of the neurons
 		 */
-		double getThreshold() const;
+		T getThreshold() const;
+
+		/**
+		 * @brief Get the activation function of the network. Networks loaded from a file
+		 *  get __actv, the identity function, as the activation function is not saved:
+		 *  it only marks networks whose real activation function is unknown
+		 * @return The activation function of the neurons
+		 */
+		activation::function getActivation() const;
 
 		/**
 		 * @brief It propagates values through the network. Use this when you want to give
@@ -191,19 +561,45 @@ namespace neuralpp  {
 		 */
 		void propagate();
 
+		/**
+		 * @brief It propagates a whole batch of samples through the network at once, which
+		 *   is much faster than setting and propagating them one by one. The values
+		 *   returned by getOutput() and getOutputs() are not affected
+		 * @param in Input values, as a contiguous block of n rows of input size values
+		 * @param n Number of samples in the batch
+		 * @param out Buffer of n rows of output size values that will contain the output
+		 *   values of the network for each sample
+		 */
+		void propagateBatch (const T *in, size_t n, T *out);
+
 		/**
 		 * @brief It sets the input for the network
-		 * @param v Vector of doubles, containing the values to give to your network
+		 * @param v Vector containing the values to give to your network
+		 */
+		void setInput (const std::vector<T>& v);
+
+		/**
+		 * @brief It sets the input for the network from a buffer owned by the caller.
+		 *   Together with propagate() and getOutputs(T*, size_t) it makes an inference
+		 *   that doesn't allocate any memory
+		 * @param v Values to give to your network
+		 * @param n Number of values in v. If it is smaller than the size of the input
+		 *   layer, the remaining inputs are set to zero
 		 */
-		void setInput (std::vector<double> v);
+		void setInput (const T *v, size_t n);
 
 		/**
-		 * @brief Save a trained neural network to a binary file
-		 * @param fname Binary file where you're going to save your network
+		 * @brief Save a trained neural network to an XML file. The file is streamed through
+		 *  a buffer, and each weight is written with the fewest digits that read back to
+		 *  the same value, so saving and loading a network doesn't change it
+		 * @param fname XML file where you're going to save your network
+		 * @param hex If true, the weights are written as hexadecimal floating point
+		 *  literals (e.g. 0x1.999999999999ap-4), which are exact and faster to write and
+		 *  to read back. The library loads them, but other XML tools may not
 		 * @throws NetworkFileWriteException When you get an error writing the network's information to
 		 * a file
 		 */
-		void save (const char* fname) throw(NetworkFileWriteException);
+		void save (const char* fname, bool hex = false) throw(NetworkFileWriteException);
 
 		/**
 		 * @brief DEPRECATED. Load a trained neural network from a binary file.
@@ -229,6 +625,34 @@ namespace neuralpp  {
 		 */
 		void saveToBinary (const char* fname) throw(NetworkFileWriteException);
 
+		/**
+		 * @brief Save the network to a model file, which can be loaded through
+		 *  loadModel() without parsing or copying anything. The file is made of a 64-byte
+		 *  header (the magic string "NPPMODL", the byte order mark 0x01020304, the format
+		 *  version, the size of the scalar type, the sizes of the layers, the epochs, a
+		 *  checksum of the weights, the learning rate, the threshold and the row strides
+		 *  of the weight matrices), followed by the weight matrices of the hidden and of
+		 *  the output layer, each one aligned to 64 bytes and laid out as in memory. The
+		 *  deltas of the weights aren't saved
+		 * @param fname Name of the file
+		 * @throws NetworkFileWriteException
+		 */
+		void saveModel (const char* fname) const throw(NetworkFileWriteException);
+
+		/**
+		 * @brief Load a network from a model file written by saveModel(). The file is
+		 *  mapped in memory, and if it was written on a machine with the same byte order
+		 *  for the same scalar type the network uses its weight matrices in place: loading
+		 *  it costs one pass over the weights to verify the checksum, and the pages of the
+		 *  file are shared by all the processes that load it. They're copied on write, so
+		 *  the network can still be trained, without changing the file. Files written with
+		 *  a different byte order or scalar type are converted while loading
+		 * @param fname Name of the file
+		 * @throws NetworkFileNotFoundException When the file can't be opened, it isn't a
+		 *  model file or its checksum doesn't match
+		 */
+		void loadModel (const std::string fname) throw(NetworkFileNotFoundException);
+
 		/**
 		 * @brief Train a network using a training set loaded from an XML file. A sample XML file
 		 *   is available in examples/adder.xml
@@ -238,6 +662,13 @@ namespace neuralpp  {
 		 */
 		void train (std::string xml, source src) throw(InvalidXMLException);
 
+		/**
+		 * @brief Train a network using a training set already parsed. The same set can
+		 *   be used to train the network as many times as needed
+		 * @param set Training set
+		 */
+		void train (const BasicTrainingSet<T>& set);
+
 		/**
 		 * @brief Initialize the training XML for the neural network
 		 * @param xml String that will contain the XML
@@ -251,6 +682,9 @@ namespace neuralpp  {
 		 *   This method called on the first string will return an XML such this:
 		 *   '&lt;training id="0"&gt;&lt;input id="0"&gt;2&lt;/input&gt;&lt;input id="1"&gt;3&lt;/input&gt;&lt;output id="0"&gt;5&lt;/output&gt;
 		 *   &lt/training&gt;'
+		 *   To train on CSV data, TrainingSet::addCSV() reads it directly, without
+		 *   going through the XML, and TrainingXMLWriter writes large XML training
+		 *   sets straight to a file
 		 *
 		 * @param id ID for the given training set (0,1,..,n)
 		 * @param set String containing input values and expected outputs
@@ -263,46 +697,68 @@ namespace neuralpp  {
 		 * @param xml XML string to be closed
 		 */
 		static void closeXML(std::string& xml);
+
+	private:
+		T target_err;
+		T min_improvement;
+		size_t patience;
+		double max_time;
+
+		double deadline;
+		stop_reason stop;
+		size_t trained_epochs;
+		T best_err;
+		size_t stale_epochs;
+
+		/**
+		 * @brief Reset the stopping criteria at the beginning of a call to train()
+		 */
+		void startTraining();
+
+		/**
+		 * @brief Reset the best error at the beginning of a training loop
+		 */
+		void startLoop();
+
+		/**
+		 * @brief Count an epoch and check the stopping criteria on its error
+		 * @param err Error of the epoch
+		 * @return true if training should stop
+		 */
+		bool stopping (T err);
 	};
 
 	/**
-	 * @class Synapsis
+	 * @class BasicSynapsis
 	 * @brief Class for managing synapsis. Don't use this class directly unless you know what
-	 *  you're doing, use NeuralNet instead
+	 *  you're doing, use NeuralNet instead. A synapsis doesn't own its weight and delta anymore:
+	 *  it's just a lightweight view over a cell of the weight matrix of the layer it belongs to
 	 */
-	class Synapsis  {
-		double delta;
-		double prev_delta;
-		double weight;
+	template <typename T>
+	class BasicSynapsis  {
+		typedef BasicLayer<T> Layer;
+		typedef BasicNeuron<T> Neuron;
+
+		Layer *layer;
+		size_t pos;
 
 		Neuron *in;
 		Neuron *out;
-		
-		double (*actv_f)(double);
 
 	public:
 		/**
 		 * @brief Empty constructor (it does nothing)
 		 */
-		Synapsis()  {}
+		BasicSynapsis()  {}
 
 		/**
 		 * @brief Constructor
+		 * @param l Layer owning the weight matrix the synapsis belongs to
+		 * @param p Position of the synapsis inside the weight matrix of the layer
 		 * @param i Input neuron
 		 * @param o Output neuron
-		 * @param a Activation function
 		 */
-		Synapsis (Neuron* i, Neuron* o, double(*a)(double));
-		
-		/**
-		 * @brief Constructor
-		 * @param i Input neuron
-		 * @param o Output neuron
-		 * @param w Weight for the synapsis (default: random)
-		 * @param a Activation function
-		 */
-		Synapsis (Neuron* i, Neuron* o,
-				double w, double(*a)(double));
+		BasicSynapsis (Layer* l, size_t p, Neuron* i, Neuron* o);
 	
 		/**
 		 * @return Reference to input neuron of the synapsis
@@ -318,32 +774,32 @@ namespace neuralpp  {
 		 * @brief Set the weight of the synapsis
 		 * @param w Weight to be set
 		 */
-		void setWeight(double w) throw(InvalidSynapticalWeightException);
+		void setWeight(T w) throw(InvalidSynapticalWeightException);
 		
 		/**
 		 * @brief It sets the delta (how much to change the weight after an update) 
 		 * of the synapsis
 		 * @param d Delta to be set
 		 */
-		void setDelta(double d) throw(InvalidSynapticalWeightException);
+		void setDelta(T d) throw(InvalidSynapticalWeightException);
 
 		/**
 		 * @brief Return the weight of the synapsis
 		 * @return Weight of the synapsis
 		 */
-		double getWeight() const;
+		T getWeight() const;
 		
 		/**
 		 * @brief Return the delta of the synapsis
 		 * @return Delta of the synapsis
 		 */
-		double getDelta() const;
+		T getDelta() const;
 		
 		/**
 		 * @brief Get the delta of the synapsis at the previous iteration
 		 * @return The previous delta
 		 */
-		double getPrevDelta() const;
+		T getPrevDelta() const;
 
 		/**
 		 * @brief Get the inertial momentum of a synapsis. This value is inversely proportional
@@ -355,96 +811,68 @@ namespace neuralpp  {
 		 * @param x The number of iterations already taken
 		 * @return The inertial momentum of the synapsis
 		 */
-		double momentum (int N, int x) const;
+		static double momentum (int N, int x);
 	};
 
 	/**
-	 * @class Neuron
+	 * @class BasicNeuron
 	 * @brief Class for managing neurons. Don't use this class directly unless you know what
-	 *  you're doing, use NeuralNet instead
+	 *  you're doing, use NeuralNet instead. Propagation and activation values of a neuron are
+	 *  stored inside its layer, so a neuron is just a view over the i-th element of a layer
 	 */
-	class Neuron  {
-		double actv_val;
-		double prop_val;
-		double threshold;
+	template <typename T>
+	class BasicNeuron  {
+		typedef BasicLayer<T> Layer;
+		typedef BasicSynapsis<T> Synapsis;
 
-		std::vector< Synapsis > in;
-		std::vector< Synapsis > out;
-
-		double (*actv_f)(double);
+		Layer *layer;
+		size_t idx;
 	
 	public:
 		/**
 		 * @brief Constructor
-		 * @param a Activation function
-		 * @param th Threshold, value in [0,1] that establishes how much a neuron must be
-		 *   'sensitive' on variations of the input values
-		 */
-		Neuron (double (*a)(double), double th = 0.0);
-
-		/**
-		 * @brief Alternative constructor, that gets also the synapsis linked to the neuron
-		 * @param in Input synapses
-		 * @param out Output synapses
-		 * @param a Activation function
-		 * @param th Threshold, value in [0,1] that establishes how much a neuron must be
-		 *   'sensitive' on variations of the input values
+		 * @param l Layer containing the neuron
+		 * @param i Index of the neuron inside the layer
 		 */
-		Neuron (std::vector<Synapsis> in, std::vector<Synapsis> out,
-				double (*a)(double), double th = 0.0);
+		BasicNeuron (Layer* l, size_t i);
 
 		/**
 		 * @brief Get the i-th synapsis connected on the input of the neuron
 		 * @param i Index of the input synapsis to get
-		 * @return Reference to the i-th synapsis
+		 * @return View over the i-th synapsis
 		 */
-		Synapsis& synIn (size_t i);
+		Synapsis synIn (size_t i);
 		
 		/**
 		 * @brief Get the i-th synapsis connected on the output of the neuron
 		 * @param i Index of the output synapsis to get
-		 * @return Reference to the i-th synapsis
-		 */
-		Synapsis& synOut (size_t i);
-
-		/**
-		 * @brief It pushes a new input synapsis
-		 * @param s Synapsis to be pushed
-		 */
-		void push_in (Synapsis s);
-		
-		/**
-		 * @brief It pushes a new output synapsis
-		 * @param s Synapsis to be pushed
+		 * @return View over the i-th synapsis
 		 */
-		void push_out (Synapsis s);
+		Synapsis synOut (size_t i);
 
 		/**
 		 * @brief Change the activation value of the neuron
 		 * @param a Activation value
 		 */
-		void setActv (double a);
+		void setActv (T a);
 
 		/**
 		 * @brief Change the propagation value of the neuron
 		 * @param p Propagation value
 		 */
-		void setProp (double p);
-
-		void setSynIn  (size_t n);
-		void setSynOut (size_t n);
+		void setProp (T p);
 
 		/**
 		 * @brief Get the activation value of the neuron
 		 * @return Activation value for the neuron
 		 */
-		double getActv();
+		T getActv();
 		
 		/**
 		 * @brief Get the propagation value of the neuron
 		 * @return Propagation value for the neuron
 		 */
-		double getProp();
+		T getProp();
 
 		/**
 		 * @brief Compute the propagation value of the neuron and set it
@@ -462,44 +890,139 @@ namespace neuralpp  {
 		 * @return Number of output synapsis
 		 */
 		size_t nOut();
-
-		/**
-		 * @brief Remove input and output synapsis from a neuron
-		 */
-		void synClear();
 	};
 
 	/**
-	 * @class Layer
+	 * @class BasicLayer
 	 * @brief Class for managing layers of neurons. Don't use this class directly unless you know what
-	 *  you're doing, use NeuralNet instead
+	 *  you're doing, use NeuralNet instead. The layer owns the propagation and activation values
+	 *  of its neurons and the dense row-major matrix of the weights of its input synapses (one
+	 *  64-bytes aligned row per neuron), together with the delta and the previous delta of each
+	 *  weight, allocated only once the network is trained. All of them, neurons included, are
+	 *  drawn from a memory arena, usually the one of the network the layer belongs to
 	 */
-	class Layer  {
-		std::vector<Neuron> elements;
-		double threshold;
+	template <typename T>
+	class BasicLayer  {
+		typedef BasicNeuron<T> Neuron;
+
+		Neuron *elements;
+		size_t n_elements;
+		T threshold;
 
 		void (*update_weights)();
 		double (*actv_f)(double);
 
-	public:
+		BasicLayer *prev;
+		BasicLayer *next;
+
+		size_t stride;
+		T *prop;
+		T *actv;
+		T *weights;
+		T *delta;
+		T *prev_delta;
+
+		ThreadPool *pool;
+		size_t par_threshold;
+
+		Arena *mem;
+		bool own_mem;
+
+		BasicLayer (const BasicLayer&);
+		BasicLayer& operator= (const BasicLayer&);
+
 		/**
-		 * @brief Constructor
+		 * @brief Get the memory taken in the arena by a layer, deltas excluded
 		 * @param sz Size of the layer
-		 * @param a Activation function
-		 * @param th Threshold, value in [0,1] that establishes how much a neuron must be
-		 *   'sensitive' on variations of the input values
+		 * @param in_sz Size of the input layer it will be linked to (0 for none)
+		 * @return Size in bytes
+		 */
+		static size_t footprint (size_t sz, size_t in_sz);
+
+		/**
+		 * @brief Get the distance between two rows of the weight matrix of a layer, i.e.
+		 *  the size of the input layer padded for the SIMD kernels
+		 * @param in_sz Size of the input layer
+		 * @return Number of elements
+		 */
+		static size_t rowStride (size_t in_sz);
+
+		/**
+		 * @brief Link a layer to another, using a weight matrix that's already in
+		 *  memory (e.g. in a mapped model file) instead of drawing a new one
+		 * @param l Layer to connect to the current as input layer
+		 * @param w size() rows of rowStride(l.size()) weights, padded with zeros
 		 */
-		Layer (size_t sz, double (*a)(double), double th = 0.0);
+		void link (BasicLayer& l, T *w);
 
 		/**
-		 * @brief Alternative constructor. It directly gets a vector of neurons to build
-		 * the layer
-		 * @param neurons Vector of neurons to be included in the layer
+		 * @brief Copy the values, the weights and the deltas of a layer with the same
+		 *  size, linked to a layer with the same size
+		 */
+		void copyFrom (const BasicLayer& l);
+
+		/**
+		 * @brief Allocate the delta buffers of the weight matrix, if not allocated yet
+		 */
+		void initDeltas();
+
+		/**
+		 * @brief Turn the gradients accumulated in the delta buffers into the deltas of the
+		 *  weights (<i>rate</i> * gradient + <i>beta</i> * previous delta), add them to the
+		 *  weights, and keep them as previous deltas for the inertial momentum
+		 * @param rate Factor the gradients are multiplied by
+		 * @param beta Inertial momentum
+		 * @throws InvalidSynapticalWeightException When a weight has grown above 1
+		 */
+		void commitChanges (T rate, T beta) throw(InvalidSynapticalWeightException);
+
+		/**
+		 * @brief Compute propagation and activation values of a range of neurons of the layer
+		 * @param first Index of the first neuron
+		 * @param last Index following the last neuron
+		 */
+		void propagateRows (size_t first, size_t last);
+
+		/**
+		 * @brief Compute propagation and activation values of the layer for the given input
+		 *  values, without touching the values stored in the neurons
+		 * @param in Activation values of the input layer (padded with zeros to the stride)
+		 * @param p Propagation values of the layer
+		 * @param a Activation values of the layer
+		 */
+		void forward (const T *in, T *p, T *a) const;
+
+		/**
+		 * @brief Add a gradient to the weights of the layer, without any locking, and
+		 *  reset it to zero
+		 * @param grad Gradient, same layout as the weights
+		 * @param rate Factor the gradient is multiplied by
+		 */
+		void addGradient (T *grad, T rate);
+
+		/**
+		 * @brief Job run by the thread pool to propagate a part of the layer
+		 */
+		static void propagateJob (void *layer, size_t part, size_t parts);
+
+		friend class BasicSynapsis<T>;
+		friend class BasicNeuron<T>;
+		friend class BasicNeuralNet<T>;
+		friend class QuantizedNeuralNet;
+
+	public:
+		/**
+		 * @brief Constructor
+		 * @param sz Size of the layer
 		 * @param a Activation function
 		 * @param th Threshold, value in [0,1] that establishes how much a neuron must be
 		 *   'sensitive' on variations of the input values
+		 * @param arena Arena to draw the memory of the layer from, which must outlive it
+		 *   (default: a private arena owned by the layer)
 		 */
-		Layer (std::vector<Neuron>& neurons, double(*a)(double), double th = 0.0);
+		BasicLayer (size_t sz, double (*a)(double), T th = 0.0, Arena *arena = NULL);
+
+		~BasicLayer();
 
 		/**
 		 * @brief Redefinition for operator []. It gets the neuron at <i>i</i>
@@ -509,28 +1032,606 @@ namespace neuralpp  {
 		Neuron& operator[] (size_t i) throw(NetworkIndexOutOfBoundsException);
 
 		/**
-		 * @brief It links a layer to another
+		 * @brief It links a layer to another. The weights of a previous link are not
+		 *   freed until the arena is released
+		 * @param l Layer to connect to the current as input layer
+		 */
+		void link (BasicLayer& l);
+
+		/**
+		 * @brief It links a layer to another, drawing the initial weights in [0,0.1)
+		 *   from the given generator
 		 * @param l Layer to connect to the current as input layer
+		 * @param rng Generator of the initial weights
 		 */
-		void link (Layer& l);
+		void link (BasicLayer& l, Random& rng);
 
 		/** 
 		 * @brief Set the input values for the neurons of the layer (just use it for the input layer)
 		 * @param v Vector containing the input values
 		 */
-		void setInput (std::vector<double> v);
+		void setInput (const std::vector<T>& v);
+
+		/**
+		 * @brief Set the input values for the neurons of the layer from a buffer (just use
+		 *  it for the input layer). Neurons beyond the first n are set to zero
+		 * @param v Input values
+		 * @param n Number of values in v
+		 */
+		void setInput (const T *v, size_t n);
 
 		/**
 		 * @brief It propagates its activation values to the output layers
 		 */
 		void propagate();
 
+		/**
+		 * @brief Compute the activation values of the layer for a whole batch of input
+		 *   samples, without touching the values stored in the neurons
+		 * @param in Activation values of the input layer, one sample per row
+		 * @param ldin Distance (in elements) between two rows of <i>in</i>
+		 * @param n Number of samples
+		 * @param out Activation values of this layer, one sample per row
+		 * @param ldout Distance (in elements) between two rows of <i>out</i>
+		 */
+		void propagateBatch (const T *in, size_t ldin, size_t n, T *out, size_t ldout);
+
 		/**
 		 * @return Number of neurons in the layer
 		 */
 		size_t size() const;
 	};
 
+	/**
+	 * @brief Neural network operating on double precision real numbers
+	 */
+	typedef BasicNeuralNet<double> NeuralNet;
+
+	/**
+	 * @brief Neural network operating on single precision real numbers. It takes half
+	 *  the memory of a NeuralNet, and its SIMD kernels process twice as many values
+	 *  per instruction
+	 */
+	typedef BasicNeuralNet<float> FloatNeuralNet;
+
+	typedef BasicLayer<double> Layer;
+	typedef BasicLayer<float> FloatLayer;
+	typedef BasicNeuron<double> Neuron;
+	typedef BasicNeuron<float> FloatNeuron;
+	typedef BasicSynapsis<double> Synapsis;
+	typedef BasicSynapsis<float> FloatSynapsis;
+
+	/**
+	 * @brief Layout of a CSV (or TSV) training set: which columns hold the input values and
+	 *  which ones the expected output values of each sample. Other columns are ignored, and
+	 *  can hold anything but the delimiter (quoted fields aren't supported)
+	 */
+	struct csvformat  {
+		size_t in_first;
+		size_t in_count;
+		size_t out_first;
+		size_t out_count;
+		char delim;
+		size_t skip;
+
+		/**
+		 * @param in_first Column of the first input value (the first column is 0)
+		 * @param in_count Number of input values, in consecutive columns
+		 * @param out_first Column of the first expected output value
+		 * @param out_count Number of expected output values, in consecutive columns
+		 * @param delim Delimiter of the columns (',' for CSV, '\t' for TSV)
+		 * @param skip Number of lines to skip at the beginning (e.g. 1 for a header)
+		 */
+		csvformat (size_t in_first, size_t in_count, size_t out_first, size_t out_count,
+				char delim = ',', size_t skip = 0)
+			: in_first(in_first), in_count(in_count), out_first(out_first),
+			  out_count(out_count), delim(delim), skip(skip)  {}
+	};
+
+	/**
+	 * @class BasicTrainingSet
+	 * @brief Training set parsed once and for all. The input and the expected output values
+	 *  of the samples are stored in two contiguous matrices, one sample per row, so the set
+	 *  can be passed to NeuralNet::train(const TrainingSet&) over and over (for several runs,
+	 *  for cross-validation or to resume training) without parsing the XML again.
+	 *
+	 *  A set can also be saved to (and loaded from) a binary dataset file, made of a 64-byte
+	 *  header (the magic string "NPPDATA", the byte order mark 0x01020304, the format version,
+	 *  the size of the scalar type, the number of input and output values of each sample and
+	 *  the number of samples, all as 32-bit integers in the byte order of the machine that
+	 *  wrote the file) followed by the matrix of the input values and by the matrix of the
+	 *  output values, each one starting at an offset aligned to 64 bytes. The file is mapped
+	 *  in memory, and its matrices used in place, so loading a dataset takes no time
+	 *  whatever its size
+	 */
+	template <typename T>
+	class BasicTrainingSet  {
+		size_t in_size;
+		size_t out_size;
+		size_t n_samples;
+		std::vector<T> inputs;
+		std::vector<T> targets;
+		const T *in_data;
+		const T *out_data;
+		MappedFile *map;
+
+		/**
+		 * @brief Widen the rows of the matrices, padding the samples already in the set
+		 *  with zeros
+		 */
+		void reshape (size_t in, size_t out);
+
+		/**
+		 * @brief Point the matrices of the set to the content of its vectors
+		 */
+		void sync();
+
+		/**
+		 * @brief Copy the samples of a mapped dataset into the set, and unmap the file
+		 */
+		void detach();
+
+		/**
+		 * @brief Add the samples in the CSV lines found in [p, end), the last one of
+		 *  which may lack its newline. The text must be followed by a NUL character
+		 * @param line Number of the last line read, updated
+		 * @param skip Number of lines still to skip, updated
+		 */
+		void parseCSV (const char *p, const char *end, const csvformat& format,
+				size_t& line, size_t& skip) throw(InvalidCSVException);
+
+	public:
+		/**
+		 * @brief Constructor for an empty set
+		 * @param in Number of input values of each sample
+		 * @param out Number of expected output values of each sample
+		 */
+		BasicTrainingSet (size_t in = 0, size_t out = 0);
+
+		/**
+		 * @brief Constructor
+		 * @param xml XML training set, in the format of examples/adder.xml. Samples with
+		 *   fewer values than the others are padded with zeros
+		 * @param src Source type from which the XML will be loaded (from a file [default]
+		 *   or from a string)
+		 * @throw InvalidXMLException
+		 */
+		BasicTrainingSet (const std::string xml,
+				typename BasicNeuralNet<T>::source src = BasicNeuralNet<T>::file)
+			throw(InvalidXMLException);
+
+		/**
+		 * @brief Copy constructor. The samples of a mapped dataset are copied in memory
+		 */
+		BasicTrainingSet (const BasicTrainingSet<T>& set);
+
+		~BasicTrainingSet();
+
+		BasicTrainingSet<T>& operator= (const BasicTrainingSet<T>& set);
+
+		/**
+		 * @brief Save the set to a binary dataset file
+		 * @param fname Name of the file
+		 * @throw DatasetFileWriteException
+		 */
+		void save (const std::string fname) const throw(DatasetFileWriteException);
+
+		/**
+		 * @brief Replace the samples of the set with the ones of a binary dataset file.
+		 *  If the file holds values of type T, it's mapped in memory and its samples are
+		 *  used in place until the set is changed; otherwise they're converted to T
+		 * @param fname Name of the file
+		 * @throw InvalidDatasetException If the file can't be opened, or it's not a valid
+		 *   dataset, or it was written on a machine with a different byte order
+		 */
+		void load (const std::string fname) throw(InvalidDatasetException);
+
+		/**
+		 * @return true if the samples of the set are read from a mapped dataset file
+		 */
+		bool mapped() const;
+
+		/**
+		 * @brief Convert an XML training set to a binary dataset file of values of type T,
+		 *  reading the XML twice as a stream (once for the sizes, once for the values)
+		 *  instead of keeping the whole set in memory
+		 * @param xml Name of the XML file, in the format of examples/adder.xml
+		 * @param fname Name of the dataset file
+		 * @throw InvalidXMLException
+		 * @throw DatasetFileWriteException
+		 */
+		static void convert (const std::string xml, const std::string fname)
+			throw(InvalidXMLException, DatasetFileWriteException);
+
+		/**
+		 * @brief Add a sample to the set
+		 * @param in inputSize() input values
+		 * @param out outputSize() expected output values
+		 */
+		void add (const T *in, const T *out);
+
+		/**
+		 * @brief Add a sample to the set. If it has more values than the previous
+		 *   samples, the rows of all of them are widened
+		 * @param in Input values
+		 * @param out Expected output values
+		 */
+		void add (const std::vector<T>& in, const std::vector<T>& out);
+
+		/**
+		 * @brief Add the rows of a CSV (or TSV) file to the set, one sample per row. The
+		 *  numbers are parsed in place from a buffer of the file, with no intermediate
+		 *  strings. Empty lines are skipped
+		 * @param csv Name of the file, or CSV text
+		 * @param format Columns holding the input and the output values
+		 * @param src Source type from which the CSV will be loaded (from a file [default]
+		 *   or from a string)
+		 * @return Number of samples added
+		 * @throw InvalidCSVException If the file can't be opened, or a row has too few
+		 *   columns or an invalid number in one of the columns of the format. The rows
+		 *   before it are added anyway
+		 */
+		size_t addCSV (const std::string csv, const csvformat& format,
+				typename BasicNeuralNet<T>::source src = BasicNeuralNet<T>::file)
+			throw(InvalidCSVException);
+
+		/**
+		 * @brief Remove all the samples from the set
+		 */
+		void clear();
+
+		/**
+		 * @return Number of samples in the set
+		 */
+		size_t size() const;
+
+		/**
+		 * @return Number of input values of each sample
+		 */
+		size_t inputSize() const;
+
+		/**
+		 * @return Number of expected output values of each sample
+		 */
+		size_t outputSize() const;
+
+		/**
+		 * @param i Index of the sample
+		 * @return Pointer to the inputSize() input values of the i-th sample
+		 */
+		const T* input (size_t i) const;
+
+		/**
+		 * @param i Index of the sample
+		 * @return Pointer to the outputSize() expected output values of the i-th sample
+		 */
+		const T* target (size_t i) const;
+	};
+
+	typedef BasicTrainingSet<double> TrainingSet;
+	typedef BasicTrainingSet<float> FloatTrainingSet;
+
+	/**
+	 * @class TrainingXMLReader
+	 * @brief Pull parser reading the samples of an XML training set (in the format of
+	 *  examples/adder.xml) one at a time. The XML is read through a small buffer, which
+	 *  only grows to fit a single tag or value, and no document tree is built, so the
+	 *  memory it takes doesn't depend on the size of the training set
+	 */
+	class TrainingXMLReader  {
+		typedef enum  { opening, closing, single } tagtype;
+
+		std::istream *in;
+		std::istream *owned;
+
+		char *buf;
+		size_t cap;
+		size_t pos;
+		size_t end;
+
+		bool started;
+		bool finished;
+		size_t count;
+
+		TrainingXMLReader (const TrainingXMLReader&);
+		TrainingXMLReader& operator= (const TrainingXMLReader&);
+
+		void init();
+
+		/**
+		 * @brief Read more data into the buffer, dropping what has been parsed already
+		 * @return false at the end of the stream
+		 */
+		bool fill();
+
+		/**
+		 * @brief Read the next element tag, skipping comments, declarations and
+		 *  processing instructions
+		 * @param text If not NULL, it gets the character data found before the tag
+		 * @param name Name of the element
+		 * @param type Type of the tag (opening, closing or empty element)
+		 * @return false at the end of the stream
+		 * @throw InvalidXMLException If the stream ends inside a tag
+		 */
+		bool nextTag (std::string *text, std::string& name, tagtype& type)
+			throw(InvalidXMLException);
+
+		template <typename T>
+		bool read (std::vector<T>& input, std::vector<T>& output) throw(InvalidXMLException);
+
+	public:
+		/**
+		 * @brief Constructor
+		 * @param fname XML file to read
+		 * @throw InvalidXMLException If the file can't be opened
+		 */
+		TrainingXMLReader (const std::string fname) throw(InvalidXMLException);
+
+		/**
+		 * @brief Constructor
+		 * @param stream Stream to read the XML from, which must outlive the reader
+		 */
+		TrainingXMLReader (std::istream& stream);
+
+		~TrainingXMLReader();
+
+		/**
+		 * @brief Read the next sample
+		 * @param input Vector that will contain the input values of the sample
+		 * @param output Vector that will contain the expected output values of the sample
+		 * @return false when there are no more samples
+		 * @throw InvalidXMLException If the XML is malformed or has no 'network' element
+		 */
+		bool next (std::vector<double>& input, std::vector<double>& output)
+			throw(InvalidXMLException);
+		bool next (std::vector<float>& input, std::vector<float>& output)
+			throw(InvalidXMLException);
+
+		/**
+		 * @return Number of samples read so far
+		 */
+		size_t samples() const;
+	};
+
+	/**
+	 * @class TrainingXMLWriter
+	 * @brief Writer of XML training sets (in the format of examples/adder.xml, the same one
+	 *  generated by NeuralNet::initXML(), XMLFromSet() and closeXML()), which streams the
+	 *  samples to a file or to a stream through a buffer of its own, instead of building
+	 *  the whole document in a string
+	 */
+	class TrainingXMLWriter  {
+		std::ostream *out;
+		std::ostream *owned;
+
+		std::string buf;
+		size_t id;
+		size_t count;
+		bool closed;
+
+		TrainingXMLWriter (const TrainingXMLWriter&);
+		TrainingXMLWriter& operator= (const TrainingXMLWriter&);
+
+		void init();
+
+		/**
+		 * @brief Write the content of the buffer to the stream
+		 * @throw DatasetFileWriteException
+		 */
+		void flush() throw(DatasetFileWriteException);
+
+		/**
+		 * @brief Append an element holding a value to the buffer
+		 * @param tag Name of the element
+		 * @param x Value
+		 * @param single true for a value of single precision, which needs fewer digits
+		 */
+		void put (const char *tag, double x, bool single);
+
+		template <typename T>
+		void write (const T *in, size_t n_in, const T *out, size_t n_out)
+			throw(DatasetFileWriteException);
+
+	public:
+		/**
+		 * @brief Constructor
+		 * @param fname XML file to write
+		 * @throw DatasetFileWriteException If the file can't be created
+		 */
+		TrainingXMLWriter (const std::string fname) throw(DatasetFileWriteException);
+
+		/**
+		 * @brief Constructor
+		 * @param stream Stream to write the XML to, which must outlive the writer
+		 */
+		TrainingXMLWriter (std::ostream& stream);
+
+		/**
+		 * @brief Destructor. It closes the document, if close() wasn't called
+		 */
+		~TrainingXMLWriter();
+
+		/**
+		 * @brief Write a sample. Each value is written with the fewest digits that
+		 *  read back to the same number
+		 * @param in Input values
+		 * @param n_in Number of input values
+		 * @param out Expected output values
+		 * @param n_out Number of expected output values
+		 * @throw DatasetFileWriteException
+		 */
+		void add (const double *in, size_t n_in, const double *out, size_t n_out)
+			throw(DatasetFileWriteException);
+		void add (const float *in, size_t n_in, const float *out, size_t n_out)
+			throw(DatasetFileWriteException);
+
+		/**
+		 * @brief Write a sample
+		 * @param in Input values
+		 * @param out Expected output values
+		 * @throw DatasetFileWriteException
+		 */
+		void add (const std::vector<double>& in, const std::vector<double>& out)
+			throw(DatasetFileWriteException);
+		void add (const std::vector<float>& in, const std::vector<float>& out)
+			throw(DatasetFileWriteException);
+
+		/**
+		 * @brief Write a sample given as a string, in the format of
+		 *  NeuralNet::XMLFromSet() (e.g. "2,3;5")
+		 * @param set String containing input values and expected outputs
+		 * @return false if the string has no ';', in which case nothing is written
+		 * @throw DatasetFileWriteException
+		 */
+		bool add (const std::string set) throw(DatasetFileWriteException);
+
+		/**
+		 * @brief Close the document and flush it to the file or to the stream. No
+		 *  samples can be added after this
+		 * @throw DatasetFileWriteException
+		 */
+		void close() throw(DatasetFileWriteException);
+
+		/**
+		 * @return Number of samples written so far
+		 */
+		size_t samples() const;
+	};
+
+	/**
+	 * @brief Accuracy of a quantized network compared to the network it was built from
+	 */
+	struct quantreport  {
+		size_t samples;
+		double max_error;
+		double mean_error;
+		size_t memory;
+		size_t ref_memory;
+	};
+
+	/**
+	 * @class QuantizedNeuralNet
+	 * @brief Inference-only copy of a trained network, whose weights are quantized to 8-bit
+	 *  integers with a scale for each neuron. The values fed to each layer are quantized on
+	 *  the fly with a scale for each sample, so that the products run on integer SIMD
+	 *  instructions. It takes about 1/8 of the memory of a NeuralNet, at the price of a
+	 *  small error on the outputs: use compare() to measure it on your own data
+	 */
+	class QuantizedNeuralNet  {
+		struct qlayer  {
+			size_t size;
+			size_t stride;
+			signed char *weights;
+			double *scales;
+			double threshold;
+			double (*actv_f)(double);
+		};
+
+		size_t in_size;
+		qlayer hidden;
+		qlayer output;
+
+		signed char *qin;
+		int *acc;
+		std::vector<double> input;
+		std::vector<double> hactv;
+		std::vector<double> oactv;
+
+		QuantizedNeuralNet (const QuantizedNeuralNet&);
+		QuantizedNeuralNet& operator= (const QuantizedNeuralNet&);
+
+		/**
+		 * @brief Quantize the weights of a layer of the original network
+		 */
+		template <typename T>
+		void quantize (qlayer& q, const BasicLayer<T>& l);
+
+		/**
+		 * @brief Compute the activation values of a layer for a single sample
+		 * @param l Layer
+		 * @param in Activation values of the previous layer
+		 * @param n Number of values in <i>in</i>
+		 * @param out Activation values of the layer
+		 */
+		void forward (const qlayer& l, const double *in, size_t n, double *out);
+
+	public:
+		/**
+		 * @brief Constructor
+		 * @param net Trained network to quantize. The quantized network does not keep
+		 *  any reference to it
+		 */
+		template <typename T>
+		QuantizedNeuralNet (const BasicNeuralNet<T>& net);
+
+		~QuantizedNeuralNet();
+
+		/**
+		 * @brief It sets the input for the network
+		 * @param v Vector containing the values to give to your network
+		 */
+		void setInput (const std::vector<double>& v);
+
+		/**
+		 * @brief It sets the input for the network from a buffer owned by the caller
+		 * @param v Values to give to your network
+		 * @param n Number of values in v. If it is smaller than the size of the input
+		 *   layer, the remaining inputs are set to zero
+		 */
+		void setInput (const double *v, size_t n);
+
+		/**
+		 * @brief It propagates the input values through the network
+		 */
+		void propagate();
+
+		/**
+		 * @brief It gets the output of the network (note: the layer output should contain
+		 * an only neuron)
+		 * @return The output value of the network
+		 */
+		double getOutput() const;
+
+		/**
+		 * @brief It gets the output of the network in case the output layer contains more neurons
+		 * @return A vector containing the output values of the network
+		 */
+		std::vector<double> getOutputs() const;
+
+		/**
+		 * @brief It copies the output values of the network into a buffer owned by the caller
+		 * @param out Buffer that will contain the output values
+		 * @param n Size of the buffer
+		 * @return Number of values copied
+		 */
+		size_t getOutputs (double *out, size_t n) const;
+
+		/**
+		 * @brief It propagates a whole batch of samples through the network. The values
+		 *   returned by getOutput() and getOutputs() are not affected
+		 * @param in Input values, as a contiguous block of n rows of input size values
+		 * @param n Number of samples in the batch
+		 * @param out Buffer of n rows of output size values
+		 */
+		void propagateBatch (const double *in, size_t n, double *out);
+
+		/**
+		 * @return Size in bytes of the weights and of the scales of the network
+		 */
+		size_t memory() const;
+
+		/**
+		 * @brief Compare the outputs of the quantized network with the ones of the network
+		 *  it was built from
+		 * @param net Original network
+		 * @param inputs Input samples to propagate through both networks
+		 * @return Maximum and mean absolute error over all the outputs, together with the
+		 *  memory taken by the weights of both networks
+		 */
+		template <typename T>
+		quantreport compare (BasicNeuralNet<T>& net, const std::vector< std::vector<double> >& inputs);
+	};
+
 	struct netrecord  {
 		int input_size;
 		int hidden_size;
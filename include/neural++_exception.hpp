@@ -56,6 +56,55 @@ namespace neuralpp  {
 		const char* what() const throw() { return error; }
 	};
 
+	/**
+	 * @class InvalidDatasetException
+	 * @brief Exception thrown when trying to load a binary training set from a file that
+	 * doesn't exist or is not a valid dataset
+	 */
+	class InvalidDatasetException : public std::exception  {
+		char *error;
+
+	public:
+		InvalidDatasetException(const char *err = " ")  {
+			error = new char[strlen(err)+50];
+			sprintf (error, "Attempt to load an invalid training dataset: %s", err);
+		}
+
+		const char* what() const throw() { return error; }
+	};
+
+	/**
+	 * @class DatasetFileWriteException
+	 * @brief Exception thrown when trying to write a training set (binary or XML) to a file that cannot
+	 * be written
+	 */
+	class DatasetFileWriteException : public std::exception  {
+	public:
+		DatasetFileWriteException()  {}
+		const char* what() const throw()  { return "There was an error while writing the dataset file"; }
+	};
+
+	/**
+	 * @class InvalidCSVException
+	 * @brief Exception thrown when trying to read a training set from a CSV file that doesn't
+	 * exist or holds rows with missing or invalid numbers
+	 */
+	class InvalidCSVException : public std::exception  {
+		char *error;
+
+	public:
+		InvalidCSVException(const char *err = " ", unsigned long line = 0)  {
+			error = new char[strlen(err)+80];
+
+			if (line)
+				sprintf (error, "Attempt to load invalid CSV data: %s at line %lu", err, line);
+			else
+				sprintf (error, "Attempt to load invalid CSV data: %s", err);
+		}
+
+		const char* what() const throw() { return error; }
+	};
+
 	/**
 	 * @class NetworkIndexOutOfBoundsException
 	 * @brief Exception raised when trying to access a neuron whose index is larger than the number
@@ -67,6 +116,17 @@ namespace neuralpp  {
 		const char* what() const throw()  { return "Attempt to access a non-existing neuron"; }
 	};
 
+	/**
+	 * @class InvalidActivationException
+	 * @brief Exception raised when copying a network into a FixedNeuralNet whose activation
+	 * function is not the one the network was trained with
+	 */
+	class InvalidActivationException : public std::exception  {
+	public:
+		InvalidActivationException()  {}
+		const char* what() const throw()  { return "The activation function doesn't match the one of the network"; }
+	};
+
 	/**
 	 * @class InvalidSynapticalWeightException
 	 * @brief Exception raised when, while trying the network or directly, the weight of a synapsis is
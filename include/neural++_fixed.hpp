@@ -0,0 +1,249 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#ifndef __NEURALPP_FIXED
+#define __NEURALPP_FIXED
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include "neural++.hpp"
+
+namespace neuralpp  {
+	namespace activation  {
+		/**
+		 * @namespace neuralpp::activation::inlined
+		 * @brief The functions in neuralpp::activation, wrapped in classes with a static
+		 *  inline member f(), to be used as template arguments of FixedNeuralNet. Unlike
+		 *  a pointer to function, they can be inlined by the compiler in the propagation
+		 *  loops. Any class with a static <i>double f(double)</i> member will do as well
+		 */
+		namespace inlined  {
+			struct identity  {
+				static inline double f (double x)  { return x; }
+			};
+
+			struct sigmoid  {
+				static inline double f (double x)  { return 1.0 / (1.0 + exp(-x)); }
+			};
+
+			struct tanh  {
+				static inline double f (double x)  { return ::tanh(x); }
+			};
+
+			struct relu  {
+				static inline double f (double x)  { return (x > 0.0) ? x : 0.0; }
+			};
+
+			struct leakyRelu  {
+				static inline double f (double x)  { return (x > 0.0) ? x : LEAKY_SLOPE * x; }
+			};
+
+			struct softplus  {
+				static inline double f (double x)  {
+					return (x > 0.0) ? x + log(1.0 + exp(-x)) : log(1.0 + exp(x));
+				}
+			};
+
+			/**
+			 * @brief The function of neuralpp::activation wrapped by one of the classes above,
+			 *  used by FixedNeuralNet to check that it matches the one of the trained
+			 *  network. NULL for user-defined classes, which are not checked
+			 */
+			template <class Activation>
+			struct function_of  {
+				static function get()  { return NULL; }
+			};
+
+			template <> struct function_of<identity>  { static function get()  { return activation::identity; } };
+			template <> struct function_of<sigmoid>  { static function get()  { return activation::sigmoid; } };
+			template <> struct function_of<tanh>  { static function get()  { return activation::tanh; } };
+			template <> struct function_of<relu>  { static function get()  { return activation::relu; } };
+			template <> struct function_of<leakyRelu>  { static function get()  { return activation::leakyRelu; } };
+			template <> struct function_of<softplus>  { static function get()  { return activation::softplus; } };
+		}
+	}
+
+	/**
+	 * @class FixedNeuralNet
+	 * @brief Inference-only network whose topology is fixed at compile time. The weights
+	 *  are stored in plain arrays inside the object, and all the loops have compile-time
+	 *  bounds, so for small networks the compiler can unroll them completely and inline
+	 *  the activation function: a propagation takes a few tens of nanoseconds, without
+	 *  touching the heap. Train the network as usual with NeuralNet, then load it here
+	 *  from the XML file or from the NeuralNet object itself
+	 * @param In Size of the input layer
+	 * @param Hidden Size of the hidden layer
+	 * @param Out Size of the output layer
+	 * @param Activation Activation function, one of the classes in
+	 *  neuralpp::activation::inlined (default: identity, the same as the default
+	 *  activation function of NeuralNet). It must match the one the network was trained with
+	 */
+	template <size_t In, size_t Hidden, size_t Out, class Activation = activation::inlined::identity>
+	class FixedNeuralNet  {
+		double w_hid[Hidden][In];
+		double w_out[Out][Hidden];
+		double threshold;
+
+		double input[In];
+		double output[Out];
+
+		/**
+		 * @brief Copy the weights of a network with the same topology
+		 * @throw NetworkIndexOutOfBoundsException If the sizes of the layers don't match
+		 * @throw InvalidActivationException If the network was built with another activation
+		 *  function. Networks loaded from a file, which don't store it and report __actv
+		 *  as their function, are not checked
+		 */
+		template <typename T>
+		void load (const BasicNeuralNet<T>& net)
+			throw(NetworkIndexOutOfBoundsException, InvalidActivationException)  {
+			if (net.input->size() != In || net.hidden->size() != Hidden || net.output->size() != Out)
+				throw NetworkIndexOutOfBoundsException();
+
+			activation::function fixed = activation::inlined::function_of<Activation>::get();
+			activation::function trained = net.getActivation();
+
+			if (fixed && trained != __actv && trained != fixed &&
+					!(fixed == activation::tanh && trained == (activation::function) ::tanh))
+				throw InvalidActivationException();
+
+			for (size_t i = 0; i < Hidden; i++)
+				for (size_t j = 0; j < In; j++)
+					w_hid[i][j] = (*net.hidden)[i].synIn(j).getWeight();
+
+			for (size_t i = 0; i < Out; i++)
+				for (size_t j = 0; j < Hidden; j++)
+					w_out[i][j] = (*net.output)[i].synIn(j).getWeight();
+
+			threshold = net.getThreshold();
+		}
+
+	public:
+		/**
+		 * @brief Constructor
+		 * @param net Trained network to copy the weights and the threshold from
+		 * @throw NetworkIndexOutOfBoundsException If the sizes of the layers don't match
+		 * @throw InvalidActivationException If the activation function doesn't match
+		 */
+		template <typename T>
+		FixedNeuralNet (const BasicNeuralNet<T>& net)
+			throw(NetworkIndexOutOfBoundsException, InvalidActivationException)  {
+			for (size_t i = 0; i < In; i++)
+				input[i] = 0.0;
+
+			load(net);
+			propagate();
+		}
+
+		/**
+		 * @brief Constructor
+		 * @param fname XML file containing a network previously saved by NeuralNet::save()
+		 * @throw NetworkFileNotFoundException
+		 * @throw InvalidXMLException If the file is invalid
+		 * @throw NetworkIndexOutOfBoundsException If the sizes of the layers don't match
+		 */
+		FixedNeuralNet (const std::string fname)
+			throw(NetworkFileNotFoundException, InvalidXMLException,
+					NetworkIndexOutOfBoundsException, InvalidActivationException)  {
+			NeuralNet net(fname);
+
+			for (size_t i = 0; i < In; i++)
+				input[i] = 0.0;
+
+			load(net);
+			propagate();
+		}
+
+		/**
+		 * @brief It propagates a sample through the network, without touching the
+		 *  input and the output values stored in the object
+		 * @param in In input values
+		 * @param out Buffer for the Out output values
+		 */
+		inline void propagate (const double *in, double *out) const  {
+			double hactv[Hidden];
+
+			for (size_t i = 0; i < Hidden; i++)  {
+				double s = 0.0;
+
+				for (size_t j = 0; j < In; j++)
+					s += w_hid[i][j] * in[j];
+
+				hactv[i] = Activation::f(s - threshold);
+			}
+
+			for (size_t i = 0; i < Out; i++)  {
+				double s = 0.0;
+
+				for (size_t j = 0; j < Hidden; j++)
+					s += w_out[i][j] * hactv[j];
+
+				out[i] = Activation::f(s - threshold);
+			}
+		}
+
+		/**
+		 * @brief It propagates the input values through the network
+		 */
+		inline void propagate()  {
+			propagate(input, output);
+		}
+
+		/**
+		 * @brief It sets the input for the network
+		 * @param v Array of In values
+		 */
+		inline void setInput (const double *v)  {
+			for (size_t i = 0; i < In; i++)
+				input[i] = v[i];
+		}
+
+		/**
+		 * @brief It sets the input for the network
+		 * @param v Vector containing the values to give to your network
+		 */
+		void setInput (const std::vector<double>& v)  {
+			for (size_t i = 0; i < In; i++)
+				input[i] = (i < v.size()) ? v[i] : 0.0;
+		}
+
+		/**
+		 * @brief It gets the output of the network (the first one, if the output layer
+		 *  contains more neurons)
+		 * @return The output value of the network
+		 */
+		inline double getOutput() const  {
+			return output[0];
+		}
+
+		/**
+		 * @brief It gets the output of the network in case the output layer contains more neurons
+		 * @return Pointer to the Out output values of the network
+		 */
+		inline const double* getOutputs() const  {
+			return output;
+		}
+
+		/**
+		 * @brief Get the threshold of the neurons in the network
+		 * @return The threshold of the neurons
+		 */
+		inline double getThreshold() const  {
+			return threshold;
+		}
+	};
+}
+
+#endif
+
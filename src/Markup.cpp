@@ -43,6 +43,196 @@ static char THIS_FILE[]=__FILE__;
 #define x_ATTRIBQUOTE MCD_T("\"") // can be double or single quote
 
 
+// Vectorized scanning of text runs in x_ParseNode, UnescapeText and DetectUTF8
+// The instruction set is chosen at compile time, e.g. build with -mavx2 for AVX2
+// Without SSE2 or AVX2, or with MARKUP_NOSIMD defined, the scanning helpers below
+// fall back to plain loops
+#if defined(MARKUP_NOSIMD)
+#elif defined(__AVX2__)
+#define MARKUP_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#define MARKUP_SSE2
+#endif
+
+// Null terminated text is scanned a vector at a time as long as the vector does
+// not cross into the next page, so it may read past the terminating null but never
+// from an unmapped page; AddressSanitizer would report those reads
+#if defined(__GNUC__)
+#define MARKUP_NOASAN __attribute__((no_sanitize_address))
+#else
+#define MARKUP_NOASAN
+#endif
+#define MARKUP_PAGESIZE 4096
+
+#if defined(MARKUP_AVX2)
+#include <immintrin.h>
+struct MarkupVec
+{
+	typedef __m256i vec;
+	enum { BYTES = 32 };
+	static vec set( char c ) { return _mm256_set1_epi8(c); };
+	MARKUP_NOASAN static vec load( const char* p ) { return _mm256_loadu_si256((const vec*)p); };
+	static vec eq( vec a, vec b ) { return _mm256_cmpeq_epi8(a,b); };
+	static vec any( vec a, vec b ) { return _mm256_or_si256(a,b); };
+	static unsigned int mask( vec a ) { return (unsigned int)_mm256_movemask_epi8(a); };
+	static unsigned int full() { return 0xffffffffu; };
+};
+#elif defined(MARKUP_SSE2)
+#include <emmintrin.h>
+struct MarkupVec
+{
+	typedef __m128i vec;
+	enum { BYTES = 16 };
+	static vec set( char c ) { return _mm_set1_epi8(c); };
+	MARKUP_NOASAN static vec load( const char* p ) { return _mm_loadu_si128((const vec*)p); };
+	static vec eq( vec a, vec b ) { return _mm_cmpeq_epi8(a,b); };
+	static vec any( vec a, vec b ) { return _mm_or_si128(a,b); };
+	static unsigned int mask( vec a ) { return (unsigned int)_mm_movemask_epi8(a); };
+	static unsigned int full() { return 0xffffu; };
+};
+#endif
+
+#if defined(MARKUP_AVX2) || defined(MARKUP_SSE2)
+static int x_LowBit( unsigned int nMask )
+{
+	// Index of the lowest set bit, nMask is not zero
+#if defined(__GNUC__)
+	return __builtin_ctz( nMask );
+#else
+	int nBit = 0;
+	while ( ! (nMask & 1) )
+	{
+		nMask >>= 1;
+		++nBit;
+	}
+	return nBit;
+#endif
+}
+
+static bool x_InPage( const char* p )
+{
+	// True if a whole vector can be loaded at p without crossing a page
+	return ((size_t)p % MARKUP_PAGESIZE) <= (size_t)(MARKUP_PAGESIZE - MarkupVec::BYTES);
+}
+#endif
+
+static const char* x_SkipASCII( const char* p, const char* pEnd )
+{
+	// Return the first byte before pEnd that is non-ASCII or null, or pEnd
+#if defined(MARKUP_AVX2) || defined(MARKUP_SSE2)
+	const MarkupVec::vec vZero = MarkupVec::set( 0 );
+	while ( pEnd - p >= MarkupVec::BYTES )
+	{
+		MarkupVec::vec v = MarkupVec::load( p );
+		unsigned int nMask = MarkupVec::mask(v) | MarkupVec::mask(MarkupVec::eq(v,vZero));
+		if ( nMask )
+			return p + x_LowBit( nMask );
+		p += MarkupVec::BYTES;
+	}
+#endif
+	while ( p < pEnd && *p && ! ((unsigned char)(*p) & 0x80) )
+		++p;
+	return p;
+}
+
+#if ! defined(MARKUP_WCHAR) && ! defined(MARKUP_MBCS) && ( defined(MARKUP_AVX2) || defined(MARKUP_SSE2) )
+// Single byte characters: x_ParseNode and UnescapeText can skip runs of text in bulk
+#define MARKUP_SCAN
+
+static const char* x_FindChar( const char* p, const char* pEnd, char c )
+{
+	// Return the first c before pEnd, or pEnd
+	const MarkupVec::vec vC = MarkupVec::set( c );
+	while ( pEnd - p >= MarkupVec::BYTES )
+	{
+		unsigned int nMask = MarkupVec::mask( MarkupVec::eq(MarkupVec::load(p),vC) );
+		if ( nMask )
+			return p + x_LowBit( nMask );
+		p += MarkupVec::BYTES;
+	}
+	while ( p < pEnd && *p != c )
+		++p;
+	return p;
+}
+
+static const char* x_ScanTo( const char* p, char c1, char c2 )
+{
+	// Return the first c1, c2 or null
+	const MarkupVec::vec v1 = MarkupVec::set( c1 );
+	const MarkupVec::vec v2 = MarkupVec::set( c2 );
+	const MarkupVec::vec vZero = MarkupVec::set( 0 );
+	while ( 1 )
+	{
+		if ( x_InPage(p) )
+		{
+			MarkupVec::vec v = MarkupVec::load( p );
+			unsigned int nMask = MarkupVec::mask( MarkupVec::any(MarkupVec::any(MarkupVec::eq(v,v1),MarkupVec::eq(v,v2)),MarkupVec::eq(v,vZero)) );
+			if ( nMask )
+				return p + x_LowBit( nMask );
+			p += MarkupVec::BYTES;
+		}
+		else if ( *p == c1 || *p == c2 || ! *p )
+			return p;
+		else
+			++p;
+	}
+}
+
+static const char* x_SkipSpace( const char* p )
+{
+	// Return the first char that is not whitespace, possibly the null
+	const MarkupVec::vec vSpace = MarkupVec::set( ' ' );
+	const MarkupVec::vec vTab = MarkupVec::set( '\t' );
+	const MarkupVec::vec vLF = MarkupVec::set( '\n' );
+	const MarkupVec::vec vCR = MarkupVec::set( '\r' );
+	while ( 1 )
+	{
+		if ( x_InPage(p) )
+		{
+			MarkupVec::vec v = MarkupVec::load( p );
+			MarkupVec::vec vWS = MarkupVec::any( MarkupVec::any(MarkupVec::eq(v,vSpace),MarkupVec::eq(v,vTab)), MarkupVec::any(MarkupVec::eq(v,vLF),MarkupVec::eq(v,vCR)) );
+			unsigned int nMask = MarkupVec::mask(vWS) ^ MarkupVec::full();
+			if ( nMask )
+				return p + x_LowBit( nMask );
+			p += MarkupVec::BYTES;
+		}
+		else if ( ! *p || ! MCD_PSZCHR(" \t\n\r",*p) )
+			return p;
+		else
+			++p;
+	}
+}
+
+static const char* x_ScanName( const char* p )
+{
+	// Return the first char ending a tag name: whitespace, '/', '>' or null
+	const MarkupVec::vec vSpace = MarkupVec::set( ' ' );
+	const MarkupVec::vec vTab = MarkupVec::set( '\t' );
+	const MarkupVec::vec vLF = MarkupVec::set( '\n' );
+	const MarkupVec::vec vCR = MarkupVec::set( '\r' );
+	const MarkupVec::vec vSlash = MarkupVec::set( '/' );
+	const MarkupVec::vec vGT = MarkupVec::set( '>' );
+	const MarkupVec::vec vZero = MarkupVec::set( 0 );
+	while ( 1 )
+	{
+		if ( x_InPage(p) )
+		{
+			MarkupVec::vec v = MarkupVec::load( p );
+			MarkupVec::vec vWS = MarkupVec::any( MarkupVec::any(MarkupVec::eq(v,vSpace),MarkupVec::eq(v,vTab)), MarkupVec::any(MarkupVec::eq(v,vLF),MarkupVec::eq(v,vCR)) );
+			MarkupVec::vec vEnd = MarkupVec::any( MarkupVec::any(MarkupVec::eq(v,vSlash),MarkupVec::eq(v,vGT)), MarkupVec::eq(v,vZero) );
+			unsigned int nMask = MarkupVec::mask( MarkupVec::any(vWS,vEnd) );
+			if ( nMask )
+				return p + x_LowBit( nMask );
+			p += MarkupVec::BYTES;
+		}
+		else if ( ! *p || MCD_PSZCHR(" \t\n\r/>",*p) )
+			return p;
+		else
+			++p;
+	}
+}
+#endif // MARKUP_SCAN
+
 // Disable "while ( 1 )" warning in VC++ 2002
 #if _MSC_VER >= 1300 // VC++ 2002 (7.0)
 #pragma warning(disable:4127)
@@ -139,7 +329,7 @@ bool CMarkup::SetDoc( const MCD_STR& strDoc )
 	return x_ParseDoc();
 }
 
-bool CMarkup::IsWellFormed()
+bool CMarkup::IsWellFormed() const
 {
 	if ( m_aPos.GetSize()
 			&& ! (m_aPos[0].nFlags & MNF_ILLFORMED)
@@ -455,7 +645,7 @@ MCD_STR CMarkup::UnescapeText( MCD_CSTR szText, int nTextLength /*=-1*/ )
 			// Look for terminating semi-colon within 9 ASCII characters
 			int nCodeLen = 0;
 			MCD_CHAR cCodeChar = pSource[nChar+1];
-			while ( nCodeLen < 9 && ((unsigned int)cCodeChar) < 128 && cCodeChar != ';' )
+			while ( nCodeLen < 9 && cCodeChar && ((unsigned int)cCodeChar) < 128 && cCodeChar != ';' )
 			{
 				if ( cCodeChar >= 'A' && cCodeChar <= 'Z') // upper case?
 					cCodeChar += ('a' - 'A'); // make lower case
@@ -546,7 +736,12 @@ MCD_STR CMarkup::UnescapeText( MCD_CSTR szText, int nTextLength /*=-1*/ )
 		}
 		else // not &
 		{
+#if defined(MARKUP_SCAN)
+			// Append the whole run up to the next ampersand
+			nCharLen = (int)(x_FindChar(&pSource[nChar],&pSource[nTextLength],'&') - &pSource[nChar]);
+#else
 			nCharLen = MCD_CLEN(&pSource[nChar]);
+#endif
 			MCD_BLDAPPENDN(strText,&pSource[nChar],nCharLen);
 			nChar += nCharLen;
 		}
@@ -579,7 +774,7 @@ bool CMarkup::DetectUTF8( const char* pText, int nTextLen, int* pnNonASCII/*=NUL
 				return false;
 		}
 		else
-			++pText;
+			pText = x_SkipASCII( pText + 1, pTextEnd );
 	}
 	return true;
 }
@@ -1751,7 +1946,11 @@ int CMarkup::x_ParseNode( CMarkup::TokenPos& token, CMarkup::NodePos& node )
 			}
 			else
 			{
+#if defined(MARKUP_SCAN)
+				pDoc = x_ScanName( pDoc + 1 );
+#else
 				pDoc += MCD_CLEN( pDoc );
+#endif
 				continue;
 			}
 		}
@@ -1904,6 +2103,25 @@ int CMarkup::x_ParseNode( CMarkup::TokenPos& token, CMarkup::NodePos& node )
 			else
 				FINDNODETYPE( MCD_T("<"), MNT_TEXT )
 		}
+
+#if defined(MARKUP_SCAN)
+		// Skip in bulk the runs in which only a few characters can change the state
+		if ( pFindEnd && ! nName && nNodeType == MNT_TEXT )
+		{
+			pDoc = x_ScanTo( pDoc + 1, '<', '>' );
+			continue;
+		}
+		if ( pFindEnd && ! nName && (nNodeType == MNT_COMMENT || nNodeType == MNT_CDATA_SECTION || nNodeType == MNT_PROCESSING_INSTRUCTION) )
+		{
+			pDoc = x_ScanTo( pDoc + 1, '>', '>' );
+			continue;
+		}
+		if ( ! pFindEnd && nParseFlags == PD_TEXTORWS )
+		{
+			pDoc = x_SkipSpace( pDoc + 1 );
+			continue;
+		}
+#endif // MARKUP_SCAN
 		pDoc += MCD_CLEN( pDoc );
 	}
 	token.nNext = nR + 1;
@@ -2096,6 +2314,94 @@ MCD_STR CMarkup::x_GetAttrib( int iPos, MCD_PCSZ pAttrib ) const
 	return MCD_T("");
 }
 
+MCD_STR CMarkup::x_GetElemAttrib( int iPos, MCD_PCSZ pAttrib ) const
+{
+	// Return the value of the attrib of the element at iPos
+	// Does not look at the current node, so it is safe to call from a CMarkupCursor
+	if ( ! iPos || ! pAttrib )
+		return MCD_T("");
+	TokenPos token( m_strDoc, m_nDocFlags );
+	token.nNext = m_aPos[iPos].nStart + 1;
+	if ( x_FindAttrib( token, pAttrib ) )
+		return UnescapeText( &token.pDoc[token.nL], token.Length() );
+	return MCD_T("");
+}
+
+bool CMarkup::x_GetElemAttribView( int iPos, MCD_PCSZ pAttrib, MCD_STRVIEW& view ) const
+{
+	// Point view at the value of the attrib of the element at iPos
+	view = MCD_STRVIEW();
+	if ( ! iPos || ! pAttrib )
+		return false;
+	TokenPos token( m_strDoc, m_nDocFlags );
+	token.nNext = m_aPos[iPos].nStart + 1;
+	if ( ! x_FindAttrib( token, pAttrib ) )
+		return false;
+	view.pcsz = &token.pDoc[token.nL];
+	view.nLength = token.Length();
+	for ( int nChar = 0; nChar < view.nLength; ++nChar )
+		if ( view.pcsz[nChar] == '&' )
+			view.bEscaped = true;
+	return true;
+}
+
+bool CMarkup::x_GetTagNameView( int iPos, MCD_STRVIEW& view ) const
+{
+	// Point view at the tag name of the element at iPos
+	view = MCD_STRVIEW();
+	if ( ! iPos )
+		return false;
+	TokenPos token( m_strDoc, m_nDocFlags );
+	token.nNext = m_aPos[iPos].nStart + 1;
+	if ( ! x_FindName( token ) )
+		return false;
+	view.pcsz = &token.pDoc[token.nL];
+	view.nLength = token.Length();
+	return true;
+}
+
+bool CMarkup::x_ViewToNum( const MCD_STRVIEW& view, double& dValue )
+{
+	// Parse a number filling the whole view, surrounding whitespace allowed
+	// Views are always followed by a delimiter ('<', a quote, whitespace or the
+	// end of a node) so the conversion stops inside the view without a copy
+	if ( view.bEscaped )
+		return x_StrToNum( UnescapeText(view.pcsz,view.nLength), dValue );
+	if ( ! view.pcsz )
+		return false;
+	MCD_PCSZ pEnd = view.pcsz + view.nLength;
+	MCD_CHAR* pStop = NULL;
+	double dParsed = MCD_PSZTOD( view.pcsz, &pStop );
+	if ( pStop == view.pcsz || pStop > pEnd )
+		return false;
+	while ( pStop < pEnd && MCD_PSZCHR(MCD_T(" \t\n\r"),*pStop) )
+		++pStop;
+	if ( pStop != pEnd )
+		return false;
+	dValue = dParsed;
+	return true;
+}
+
+bool CMarkup::x_ViewToNum( const MCD_STRVIEW& view, int& nValue )
+{
+	// Same as above for a decimal integer
+	if ( view.bEscaped )
+		return x_StrToNum( UnescapeText(view.pcsz,view.nLength), nValue );
+	if ( ! view.pcsz )
+		return false;
+	MCD_PCSZ pEnd = view.pcsz + view.nLength;
+	MCD_CHAR* pStop = NULL;
+	long nParsed = MCD_PSZTOL( view.pcsz, &pStop, 10 );
+	if ( pStop == view.pcsz || pStop > pEnd || (long)(int)nParsed != nParsed )
+		return false;
+	while ( pStop < pEnd && MCD_PSZCHR(MCD_T(" \t\n\r"),*pStop) )
+		++pStop;
+	if ( pStop != pEnd )
+		return false;
+	nValue = (int)nParsed;
+	return true;
+}
+
 bool CMarkup::x_SetAttrib( int iPos, MCD_PCSZ pAttrib, int nValue, int nFlags /*=0*/ )
 {
 	// Convert integer to string
@@ -2285,7 +2591,67 @@ MCD_STR CMarkup::x_GetData( int iPos ) const
 		else
 			return MCD_STRMID( m_strDoc, m_nNodeOffset, m_nNodeLength );
 	}
+	return x_GetElemData( iPos );
+}
+
+bool CMarkup::x_GetDataView( int iPos, MCD_STRVIEW& view ) const
+{
+	// Same as x_GetData without the copy
+	view = MCD_STRVIEW();
+	if ( iPos == m_iPos && m_nNodeLength )
+	{
+		MCD_PCSZ pNode = &(MCD_2PCSZ(m_strDoc))[m_nNodeOffset];
+		if ( m_nNodeType == MNT_COMMENT )
+			{ view.pcsz = pNode + 4; view.nLength = m_nNodeLength - 7; }
+		else if ( m_nNodeType == MNT_PROCESSING_INSTRUCTION )
+			{ view.pcsz = pNode + 2; view.nLength = m_nNodeLength - 4; }
+		else if ( m_nNodeType == MNT_CDATA_SECTION )
+			{ view.pcsz = pNode + 9; view.nLength = m_nNodeLength - 12; }
+		else if ( m_nNodeType == MNT_LONE_END_TAG )
+			{ view.pcsz = pNode + 2; view.nLength = m_nNodeLength - 3; }
+		else
+		{
+			view.pcsz = pNode;
+			view.nLength = m_nNodeLength;
+			if ( m_nNodeType == MNT_TEXT )
+				for ( int nChar = 0; nChar < view.nLength; ++nChar )
+					if ( pNode[nChar] == '&' )
+						view.bEscaped = true;
+		}
+		return true;
+	}
+	return x_GetElemDataView( iPos, view );
+}
 
+bool CMarkup::x_GetElemDataView( int iPos, MCD_STRVIEW& view ) const
+{
+	// Point view at the data between start and end tag of the element at iPos
+	// Returns false if there is no element or the content contains markup
+	// (child elements, CDATA sections, comments) which x_GetData concatenates
+	view = MCD_STRVIEW();
+	if ( ! iPos || m_aPos[iPos].iElemChild )
+		return false;
+	if ( m_aPos[iPos].IsEmptyElement() )
+	{
+		view.pcsz = &(MCD_2PCSZ(m_strDoc))[m_aPos[iPos].StartAfter()];
+		return true;
+	}
+	int nContentLen = m_aPos[iPos].ContentLen();
+	MCD_PCSZ pszContent = &(MCD_2PCSZ(m_strDoc))[m_aPos[iPos].StartContent()];
+	for ( int nChar = 0; nChar < nContentLen; ++nChar )
+	{
+		if ( pszContent[nChar] == '<' )
+			return false;
+		if ( pszContent[nChar] == '&' )
+			view.bEscaped = true;
+	}
+	view.pcsz = pszContent;
+	view.nLength = nContentLen;
+	return true;
+}
+
+MCD_STR CMarkup::x_GetElemData( int iPos ) const
+{
 	// Return a string representing data between start and end tag
 	// Return empty string if there are any children elements
 	MCD_STR strData;
@@ -2317,6 +2683,64 @@ MCD_STR CMarkup::x_GetData( int iPos ) const
 	return strData;
 }
 
+bool CMarkupCursor::FindElem( MCD_CSTR szName )
+{
+	// Same as CMarkup::FindElem, on the cursor position
+	if ( m_pMarkup->m_aPos.GetSize() )
+	{
+		int iPos = m_pMarkup->x_FindElem( m_iPosParent, m_iPos, szName );
+		if ( iPos )
+		{
+			m_iPosParent = m_pMarkup->m_aPos[iPos].iElemParent;
+			m_iPos = iPos;
+			m_iPosChild = 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool CMarkupCursor::FindChildElem( MCD_CSTR szName )
+{
+	// Same as CMarkup::FindChildElem, on the cursor position
+	if ( ! m_iPos )
+		FindElem();
+
+	int iPosChild = m_pMarkup->x_FindElem( m_iPos, m_iPosChild, szName );
+	if ( iPosChild )
+	{
+		m_iPos = m_pMarkup->m_aPos[iPosChild].iElemParent;
+		m_iPosParent = m_pMarkup->m_aPos[m_iPos].iElemParent;
+		m_iPosChild = iPosChild;
+		return true;
+	}
+	return false;
+}
+
+bool CMarkupCursor::IntoElem()
+{
+	if ( m_iPos )
+	{
+		m_iPosParent = m_iPos;
+		m_iPos = m_iPosChild;
+		m_iPosChild = 0;
+		return true;
+	}
+	return false;
+}
+
+bool CMarkupCursor::OutOfElem()
+{
+	if ( m_iPosParent )
+	{
+		m_iPosChild = m_iPos;
+		m_iPos = m_iPosParent;
+		m_iPosParent = m_pMarkup->m_aPos[m_iPosParent].iElemParent;
+		return true;
+	}
+	return false;
+}
+
 MCD_STR CMarkup::x_GetElemContent( int iPos ) const
 {
 	if ( iPos && m_aPos[iPos].ContentLen() )
@@ -0,0 +1,91 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include <cmath>
+#include "neural++.hpp"
+
+namespace neuralpp  {
+	namespace activation  {
+		double identity (double x)  {
+			return x;
+		}
+
+		double sigmoid (double x)  {
+			return 1.0 / (1.0 + exp(-x));
+		}
+
+		double tanh (double x)  {
+			return ::tanh(x);
+		}
+
+		double relu (double x)  {
+			return (x > 0.0) ? x : 0.0;
+		}
+
+		double leakyRelu (double x)  {
+			return (x > 0.0) ? x : LEAKY_SLOPE * x;
+		}
+
+		double softplus (double x)  {
+			// ln(1 + e^x) = x + ln(1 + e^-x), which doesn't overflow for large x
+			return (x > 0.0) ? x + log(1.0 + exp(-x)) : log(1.0 + exp(x));
+		}
+
+		static double d_identity (double x, double fx)  {
+			return 1.0;
+		}
+
+		static double d_sigmoid (double x, double fx)  {
+			return fx * (1.0 - fx);
+		}
+
+		static double d_tanh (double x, double fx)  {
+			return 1.0 - fx*fx;
+		}
+
+		static double d_relu (double x, double fx)  {
+			return (x > 0.0) ? 1.0 : 0.0;
+		}
+
+		static double d_leakyRelu (double x, double fx)  {
+			return (x > 0.0) ? 1.0 : LEAKY_SLOPE;
+		}
+
+		static double d_softplus (double x, double fx)  {
+			return sigmoid(x);
+		}
+
+		derivative_f derivative (double (*f)(double))  {
+			if (f == identity || f == __actv)
+				return d_identity;
+
+			if (f == sigmoid)
+				return d_sigmoid;
+
+			if (f == tanh || f == (double (*)(double)) ::tanh)
+				return d_tanh;
+
+			if (f == relu)
+				return d_relu;
+
+			if (f == leakyRelu)
+				return d_leakyRelu;
+
+			if (f == softplus)
+				return d_softplus;
+
+			return NULL;
+		}
+	}
+}
+
@@ -0,0 +1,91 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "arena.hpp"
+
+namespace neuralpp  {
+	/**
+	 * Minimum size of the blocks taken from the system
+	 */
+	static const size_t MIN_BLOCK = 16 * 1024;
+
+	Arena::Arena()  {
+		head = NULL;
+		total = 0;
+	}
+
+	Arena::~Arena()  {
+		release();
+	}
+
+	size_t Arena::padded (size_t n)  {
+		return ((n + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+	}
+
+	size_t Arena::size() const  {
+		return total;
+	}
+
+	void Arena::grow (size_t n)  {
+		void *p = NULL;
+
+		if (n < MIN_BLOCK)
+			n = MIN_BLOCK;
+
+		// The header of the block takes the first aligned chunk
+		if (posix_memalign(&p, ALIGNMENT, ALIGNMENT + n))
+			throw std::bad_alloc();
+
+		memset((char*) p + ALIGNMENT, 0x0, n);
+
+		block *b = (block*) p;
+		b->next = head;
+		b->size = n;
+		b->used = 0;
+
+		head = b;
+		total += ALIGNMENT + n;
+	}
+
+	void Arena::reserve (size_t n)  {
+		if (!head || head->size - head->used < n)
+			grow(n);
+	}
+
+	void* Arena::allocate (size_t n)  {
+		n = padded(n);
+
+		if (!n)
+			return NULL;
+
+		reserve(n);
+
+		void *p = (char*) head + ALIGNMENT + head->used;
+		head->used += n;
+		return p;
+	}
+
+	void Arena::release()  {
+		while (head)  {
+			block *next = head->next;
+			free(head);
+			head = next;
+		}
+
+		total = 0;
+	}
+}
+
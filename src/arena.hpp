@@ -0,0 +1,94 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#ifndef __NEURALPP_ARENA
+#define __NEURALPP_ARENA
+
+#include <cstddef>
+
+namespace neuralpp  {
+	/**
+	 * @class Arena
+	 * @brief Memory arena a network draws its layers, neurons and buffers from. Memory is
+	 *  taken from the system in large blocks, carved out sequentially, and given back all at
+	 *  once when the arena is released or destroyed: single allocations are never freed
+	 */
+	class Arena  {
+	public:
+		/**
+		 * @brief Alignment (in bytes) of each allocation
+		 */
+		static const size_t ALIGNMENT = 64;
+
+		Arena();
+		~Arena();
+
+		/**
+		 * @brief Make sure that the next n bytes of allocations are carved out of a single
+		 *  block, taking a new one from the system if the current one is too small
+		 * @param n Number of bytes, as the sum of the padded() sizes of the allocations
+		 */
+		void reserve (size_t n);
+
+		/**
+		 * @brief Allocate a block of memory, aligned to ALIGNMENT and set to zero
+		 * @param n Size in bytes
+		 * @return Pointer to the memory, valid until the arena is released
+		 * @throw std::bad_alloc
+		 */
+		void* allocate (size_t n);
+
+		/**
+		 * @brief Allocate a zeroed array of n elements of type T
+		 */
+		template <typename T>
+		T* alloc (size_t n)  { return (T*) allocate(n * sizeof(T)); }
+
+		/**
+		 * @brief Give all the memory of the arena back to the system
+		 */
+		void release();
+
+		/**
+		 * @return Number of bytes taken from the system
+		 */
+		size_t size() const;
+
+		/**
+		 * @return Size n rounded up to a multiple of the alignment, i.e. the number of
+		 *  bytes an allocation of n bytes takes in the arena
+		 */
+		static size_t padded (size_t n);
+
+	private:
+		struct block  {
+			block *next;
+			size_t size;
+			size_t used;
+		};
+
+		block *head;
+		size_t total;
+
+		Arena (const Arena&);
+		Arena& operator= (const Arena&);
+
+		/**
+		 * @brief Take a new block of at least n bytes from the system
+		 */
+		void grow (size_t n);
+	};
+}
+
+#endif
+
@@ -0,0 +1,386 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include "kernels.hpp"
+
+#if defined(__AVX512F__)
+#	define NEURALPP_AVX512
+#elif defined(__AVX2__)
+#	define NEURALPP_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#	define NEURALPP_SSE2
+#endif
+
+#if defined(NEURALPP_AVX512) || defined(NEURALPP_AVX2)
+#	include <immintrin.h>
+#elif defined(NEURALPP_SSE2)
+#	include <emmintrin.h>
+#endif
+
+namespace neuralpp  {
+	namespace kernels  {
+		/**
+		 * Size in bytes of the tiles of the weight matrix walked by gemm
+		 */
+		static const size_t TILE_BYTES = 128 * 1024;
+
+		/*
+		 * Each SIMD path is described by two traits structures, one for doubles and one for
+		 * floats, providing the vector type, its width and the few operations the kernels need
+		 */
+#if defined(NEURALPP_AVX512)
+		struct dvec  {
+			typedef double scalar;
+			typedef double result;
+			typedef __m512d vec;
+			static const size_t LANES = 8;
+
+			static inline vec zero()  { return _mm512_setzero_pd(); }
+			static inline vec load (const double *p)  { return _mm512_loadu_pd(p); }
+			static inline vec madd (vec a, vec b, vec c)  { return _mm512_fmadd_pd(a, b, c); }
+			static inline double sum (vec a)  { return _mm512_reduce_add_pd(a); }
+		};
+
+		struct fvec  {
+			typedef float scalar;
+			typedef float result;
+			typedef __m512 vec;
+			static const size_t LANES = 16;
+
+			static inline vec zero()  { return _mm512_setzero_ps(); }
+			static inline vec load (const float *p)  { return _mm512_loadu_ps(p); }
+			static inline vec madd (vec a, vec b, vec c)  { return _mm512_fmadd_ps(a, b, c); }
+			static inline float sum (vec a)  { return _mm512_reduce_add_ps(a); }
+		};
+
+		const char* simd()  { return "avx512"; }
+#elif defined(NEURALPP_AVX2)
+		struct dvec  {
+			typedef double scalar;
+			typedef double result;
+			typedef __m256d vec;
+			static const size_t LANES = 4;
+
+			static inline vec zero()  { return _mm256_setzero_pd(); }
+			static inline vec load (const double *p)  { return _mm256_loadu_pd(p); }
+
+#	if defined(__FMA__)
+			static inline vec madd (vec a, vec b, vec c)  { return _mm256_fmadd_pd(a, b, c); }
+#	else
+			static inline vec madd (vec a, vec b, vec c)  { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#	endif
+
+			static inline double sum (vec a)  {
+				__m128d s = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+				return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+			}
+		};
+
+		struct fvec  {
+			typedef float scalar;
+			typedef float result;
+			typedef __m256 vec;
+			static const size_t LANES = 8;
+
+			static inline vec zero()  { return _mm256_setzero_ps(); }
+			static inline vec load (const float *p)  { return _mm256_loadu_ps(p); }
+
+#	if defined(__FMA__)
+			static inline vec madd (vec a, vec b, vec c)  { return _mm256_fmadd_ps(a, b, c); }
+#	else
+			static inline vec madd (vec a, vec b, vec c)  { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#	endif
+
+			static inline float sum (vec a)  {
+				__m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+				s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+				return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+			}
+		};
+
+		const char* simd()  { return "avx2"; }
+#elif defined(NEURALPP_SSE2)
+		struct dvec  {
+			typedef double scalar;
+			typedef double result;
+			typedef __m128d vec;
+			static const size_t LANES = 2;
+
+			static inline vec zero()  { return _mm_setzero_pd(); }
+			static inline vec load (const double *p)  { return _mm_loadu_pd(p); }
+			static inline vec madd (vec a, vec b, vec c)  { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+			static inline double sum (vec a)  { return _mm_cvtsd_f64(_mm_add_sd(a, _mm_unpackhi_pd(a, a))); }
+		};
+
+		struct fvec  {
+			typedef float scalar;
+			typedef float result;
+			typedef __m128 vec;
+			static const size_t LANES = 4;
+
+			static inline vec zero()  { return _mm_setzero_ps(); }
+			static inline vec load (const float *p)  { return _mm_loadu_ps(p); }
+			static inline vec madd (vec a, vec b, vec c)  { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+			static inline float sum (vec a)  {
+				__m128 s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+				return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+			}
+		};
+
+		const char* simd()  { return "sse2"; }
+#else
+		template <typename T, typename R = T>
+		struct scalarvec  {
+			typedef T scalar;
+			typedef R result;
+			typedef R vec;
+			static const size_t LANES = 1;
+
+			static inline vec zero()  { return 0; }
+			static inline vec load (const T *p)  { return *p; }
+			static inline vec madd (vec a, vec b, vec c)  { return a*b + c; }
+			static inline R sum (vec a)  { return a; }
+		};
+
+		typedef scalarvec<double> dvec;
+		typedef scalarvec<float> fvec;
+
+		const char* simd()  { return "scalar"; }
+#endif
+
+		/*
+		 * 8-bit integers are sign-extended to 16 bits on load, so that madd can multiply
+		 * them and sum the adjacent products in 32-bit lanes without overflowing
+		 */
+#if defined(NEURALPP_AVX512) || defined(NEURALPP_AVX2)
+		struct bvec  {
+			typedef signed char scalar;
+			typedef int result;
+			typedef __m256i vec;
+			static const size_t LANES = 16;
+
+			static inline vec zero()  { return _mm256_setzero_si256(); }
+
+			static inline vec load (const signed char *p)  {
+				return _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) p));
+			}
+
+			static inline vec madd (vec a, vec b, vec c)  {
+				return _mm256_add_epi32(_mm256_madd_epi16(a, b), c);
+			}
+
+			static inline int sum (vec a)  {
+				__m128i s = _mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+				s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+				s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+				return _mm_cvtsi128_si32(s);
+			}
+		};
+#elif defined(NEURALPP_SSE2)
+		struct bvec  {
+			typedef signed char scalar;
+			typedef int result;
+			typedef __m128i vec;
+			static const size_t LANES = 8;
+
+			static inline vec zero()  { return _mm_setzero_si128(); }
+
+			// SSE2 has no sign extension: each byte is paired with itself and the
+			// 16-bit words are shifted back arithmetically
+			static inline vec load (const signed char *p)  {
+				__m128i v = _mm_loadl_epi64((const __m128i*) p);
+				return _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+			}
+
+			static inline vec madd (vec a, vec b, vec c)  {
+				return _mm_add_epi32(_mm_madd_epi16(a, b), c);
+			}
+
+			static inline int sum (vec a)  {
+				__m128i s = _mm_add_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+				s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+				return _mm_cvtsi128_si32(s);
+			}
+		};
+#else
+		typedef scalarvec<signed char, int> bvec;
+#endif
+
+		template <class V>
+		static typename V::result dotImpl (const typename V::scalar *a,
+				const typename V::scalar *b, size_t n)  {
+			typename V::vec acc0 = V::zero(), acc1 = V::zero();
+			size_t i = 0;
+			typename V::result sum;
+
+			for (; i + 2*V::LANES <= n; i += 2*V::LANES)  {
+				acc0 = V::madd(V::load(a+i), V::load(b+i), acc0);
+				acc1 = V::madd(V::load(a+i+V::LANES), V::load(b+i+V::LANES), acc1);
+			}
+
+			for (; i + V::LANES <= n; i += V::LANES)
+				acc0 = V::madd(V::load(a+i), V::load(b+i), acc0);
+
+			sum = V::sum(acc0) + V::sum(acc1);
+
+			for (; i < n; i++)
+				sum += a[i] * b[i];
+
+			return sum;
+		}
+
+		template <class V>
+		static void gemvImpl (const typename V::scalar *w, size_t rows, size_t n, size_t stride,
+				const typename V::scalar *x, typename V::result *y)  {
+			typedef typename V::scalar T;
+			typedef typename V::result R;
+			typedef typename V::vec vec;
+			size_t r = 0;
+
+			// Four rows at a time, so that each chunk of x is loaded only once
+			for (; r + 4 <= rows; r += 4)  {
+				const T *w0 = w + r*stride,
+				       *w1 = w0 + stride,
+				       *w2 = w1 + stride,
+				       *w3 = w2 + stride;
+
+				vec acc0 = V::zero(), acc1 = V::zero(), acc2 = V::zero(), acc3 = V::zero();
+				size_t i = 0;
+
+				for (; i + V::LANES <= n; i += V::LANES)  {
+					vec xv = V::load(x+i);
+					acc0 = V::madd(V::load(w0+i), xv, acc0);
+					acc1 = V::madd(V::load(w1+i), xv, acc1);
+					acc2 = V::madd(V::load(w2+i), xv, acc2);
+					acc3 = V::madd(V::load(w3+i), xv, acc3);
+				}
+
+				R s0 = V::sum(acc0), s1 = V::sum(acc1), s2 = V::sum(acc2), s3 = V::sum(acc3);
+
+				for (; i < n; i++)  {
+					s0 += w0[i] * x[i];
+					s1 += w1[i] * x[i];
+					s2 += w2[i] * x[i];
+					s3 += w3[i] * x[i];
+				}
+
+				y[r]   = s0;
+				y[r+1] = s1;
+				y[r+2] = s2;
+				y[r+3] = s3;
+			}
+
+			for (; r < rows; r++)
+				y[r] = dotImpl<V>(w + r*stride, x, n);
+		}
+
+		template <class V>
+		static void gemmImpl (const typename V::scalar *w, size_t rows, size_t n, size_t stride,
+				const typename V::scalar *x, size_t ldx, size_t m,
+				typename V::scalar *y, size_t ldy)  {
+			typedef typename V::scalar T;
+			typedef typename V::vec vec;
+			size_t tile = (stride) ? TILE_BYTES / (stride * sizeof(T)) : rows;
+
+			if (tile < 4)
+				tile = 4;
+
+			for (size_t r0 = 0; r0 < rows; r0 += tile)  {
+				size_t r1 = (r0 + tile < rows) ? r0 + tile : rows;
+				size_t s = 0;
+
+				for (; s + 4 <= m; s += 4)  {
+					const T *x0 = x + s*ldx,
+					       *x1 = x0 + ldx,
+					       *x2 = x1 + ldx,
+					       *x3 = x2 + ldx;
+
+					T *y0 = y + s*ldy,
+					  *y1 = y0 + ldy,
+					  *y2 = y1 + ldy,
+					  *y3 = y2 + ldy;
+
+					for (size_t r = r0; r < r1; r++)  {
+						const T *wr = w + r*stride;
+						vec acc0 = V::zero(), acc1 = V::zero(), acc2 = V::zero(), acc3 = V::zero();
+						size_t i = 0;
+
+						for (; i + V::LANES <= n; i += V::LANES)  {
+							vec wv = V::load(wr+i);
+							acc0 = V::madd(wv, V::load(x0+i), acc0);
+							acc1 = V::madd(wv, V::load(x1+i), acc1);
+							acc2 = V::madd(wv, V::load(x2+i), acc2);
+							acc3 = V::madd(wv, V::load(x3+i), acc3);
+						}
+
+						T s0 = V::sum(acc0), s1 = V::sum(acc1), s2 = V::sum(acc2), s3 = V::sum(acc3);
+
+						for (; i < n; i++)  {
+							s0 += wr[i] * x0[i];
+							s1 += wr[i] * x1[i];
+							s2 += wr[i] * x2[i];
+							s3 += wr[i] * x3[i];
+						}
+
+						y0[r] = s0;
+						y1[r] = s1;
+						y2[r] = s2;
+						y3[r] = s3;
+					}
+				}
+
+				for (; s < m; s++)
+					gemvImpl<V>(w + r0*stride, r1 - r0, n, stride, x + s*ldx, y + s*ldy + r0);
+			}
+		}
+
+		double dot (const double *a, const double *b, size_t n)  {
+			return dotImpl<dvec>(a, b, n);
+		}
+
+		float dot (const float *a, const float *b, size_t n)  {
+			return dotImpl<fvec>(a, b, n);
+		}
+
+		void gemv (const double *w, size_t rows, size_t n, size_t stride,
+				const double *x, double *y)  {
+			gemvImpl<dvec>(w, rows, n, stride, x, y);
+		}
+
+		void gemv (const float *w, size_t rows, size_t n, size_t stride,
+				const float *x, float *y)  {
+			gemvImpl<fvec>(w, rows, n, stride, x, y);
+		}
+
+		int dot (const signed char *a, const signed char *b, size_t n)  {
+			return dotImpl<bvec>(a, b, n);
+		}
+
+		void gemv (const signed char *w, size_t rows, size_t n, size_t stride,
+				const signed char *x, int *y)  {
+			gemvImpl<bvec>(w, rows, n, stride, x, y);
+		}
+
+		void gemm (const double *w, size_t rows, size_t n, size_t stride,
+				const double *x, size_t ldx, size_t m, double *y, size_t ldy)  {
+			gemmImpl<dvec>(w, rows, n, stride, x, ldx, m, y, ldy);
+		}
+
+		void gemm (const float *w, size_t rows, size_t n, size_t stride,
+				const float *x, size_t ldx, size_t m, float *y, size_t ldy)  {
+			gemmImpl<fvec>(w, rows, n, stride, x, ldx, m, y, ldy);
+		}
+	}
+}
+
@@ -0,0 +1,101 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#ifndef __NEURALPP_KERNELS
+#define __NEURALPP_KERNELS
+
+#include <cstddef>
+
+/**
+ * @namespace neuralpp::kernels
+ * @brief Low-level numerical kernels used by the layers of the network. The SIMD
+ *  path (AVX-512, AVX2 or SSE2, falling back on plain C++) is chosen at compile
+ *  time according to the target architecture, so build the library with e.g.
+ *  ARCHFLAGS=-march=native to enable the widest one available on your machine
+ */
+namespace neuralpp  {
+	namespace kernels  {
+		/**
+		 * @brief Get the name of the SIMD instruction set the kernels were built for
+		 * @return "avx512", "avx2", "sse2" or "scalar"
+		 */
+		const char* simd();
+
+		/**
+		 * @brief Dot product between two vectors
+		 * @param a First vector
+		 * @param b Second vector
+		 * @param n Number of elements of the vectors
+		 * @return Dot product between a and b
+		 */
+		double dot (const double *a, const double *b, size_t n);
+		float dot (const float *a, const float *b, size_t n);
+
+		/**
+		 * @brief Dot product between two vectors of 8-bit integers
+		 * @param a First vector
+		 * @param b Second vector
+		 * @param n Number of elements of the vectors
+		 * @return Dot product between a and b, accumulated on 32 bits
+		 */
+		int dot (const signed char *a, const signed char *b, size_t n);
+
+		/**
+		 * @brief Matrix-vector product y = W x, with W stored by rows
+		 * @param w Weight matrix
+		 * @param rows Number of rows of the matrix
+		 * @param n Number of columns of the matrix (and elements of x)
+		 * @param stride Distance (in elements) between two rows of the matrix
+		 * @param x Input vector
+		 * @param y Output vector, with at least <i>rows</i> elements
+		 */
+		void gemv (const double *w, size_t rows, size_t n, size_t stride,
+				const double *x, double *y);
+		void gemv (const float *w, size_t rows, size_t n, size_t stride,
+				const float *x, float *y);
+
+		/**
+		 * @brief Matrix-vector product y = W x over 8-bit integers, accumulated on 32 bits
+		 * @param w Weight matrix
+		 * @param rows Number of rows of the matrix
+		 * @param n Number of columns of the matrix (and elements of x)
+		 * @param stride Distance (in elements) between two rows of the matrix
+		 * @param x Input vector
+		 * @param y Output vector, with at least <i>rows</i> elements
+		 */
+		void gemv (const signed char *w, size_t rows, size_t n, size_t stride,
+				const signed char *x, int *y);
+
+		/**
+		 * @brief Matrix-matrix product Y = X W^T, i.e. the matrix-vector product y = W x
+		 *  for each of the rows x of X. The weights are walked in tiles that fit in cache,
+		 *  and each row of weights is reused for four samples at a time
+		 * @param w Weight matrix
+		 * @param rows Number of rows of the weight matrix
+		 * @param n Number of columns of the weight matrix (and of X)
+		 * @param stride Distance (in elements) between two rows of the weight matrix
+		 * @param x Input matrix, one sample per row
+		 * @param ldx Distance (in elements) between two rows of X
+		 * @param m Number of rows (samples) of X
+		 * @param y Output matrix, with m rows of at least <i>rows</i> elements
+		 * @param ldy Distance (in elements) between two rows of Y
+		 */
+		void gemm (const double *w, size_t rows, size_t n, size_t stride,
+				const double *x, size_t ldx, size_t m, double *y, size_t ldy);
+		void gemm (const float *w, size_t rows, size_t n, size_t stride,
+				const float *x, size_t ldx, size_t m, float *y, size_t ldy);
+	}
+}
+
+#endif
+
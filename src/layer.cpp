@@ -11,67 +11,262 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
  **************************************************************************************************/
 
-#include <cstdlib>
+#include <cstring>
+#include <new>
 #include "neural++.hpp"
+#include "arena.hpp"
+#include "kernels.hpp"
+#include "threadpool.hpp"
 
 using std::vector;
 
 namespace neuralpp {
-	Layer::Layer(size_t sz, double (*a) (double), double th) {
-		for (size_t i = 0; i < sz; i++) {
-			Neuron n(a,th);
-			elements.push_back(n);
-		}
+	/**
+	 * Size of a buffer of n elements padded to a multiple of the alignment, so
+	 * that the SIMD kernels can scan whole rows without any scalar tail
+	 */
+	template <typename T>
+	static size_t padded (size_t n)  {
+		size_t align = Arena::ALIGNMENT / sizeof(T);
+		return ((n + align - 1) / align) * align;
+	}
+
+	template <typename T>
+	BasicLayer<T>::BasicLayer(size_t sz, double (*a) (double), T th, Arena *arena) {
+		own_mem = (arena == NULL);
+		mem = (own_mem) ? new Arena : arena;
+		mem->reserve(footprint(sz, 0));
+
+		n_elements = sz;
+		elements = mem->alloc<Neuron>(sz);
+
+		for (size_t i = 0; i < sz; i++)
+			new (elements + i) Neuron(this, i);
 		
 		threshold = th;
 		actv_f = a;
+		update_weights = NULL;
+
+		prev = NULL;
+		next = NULL;
+		stride = 0;
+		prop = mem->alloc<T>(padded<T>(sz));
+		actv = mem->alloc<T>(padded<T>(sz));
+		weights = NULL;
+		delta = NULL;
+		prev_delta = NULL;
+
+		pool = NULL;
+		par_threshold = 0;
 	}
 
-	Layer::Layer(vector<Neuron> &el, double (*a) (double), double th) {
-		elements = el;
-		actv_f = a;
-		threshold = th;
+	template <typename T>
+	BasicLayer<T>::~BasicLayer()  {
+		// Neurons are plain views, so the arena can just drop them
+		if (own_mem)
+			delete mem;
+	}
+
+	template <typename T>
+	size_t BasicLayer<T>::footprint (size_t sz, size_t in_sz)  {
+		return Arena::padded(sz * sizeof(Neuron)) +
+			2 * Arena::padded(padded<T>(sz) * sizeof(T)) +
+			Arena::padded(sz * padded<T>(in_sz) * sizeof(T));
+	}
+
+	template <typename T>
+	size_t BasicLayer<T>::rowStride (size_t in_sz)  {
+		return padded<T>(in_sz);
+	}
+
+	template <typename T>
+	void BasicLayer<T>::copyFrom (const BasicLayer<T>& l)  {
+		size_t n = padded<T>(size());
+
+		threshold = l.threshold;
+		actv_f = l.actv_f;
+		memcpy(prop, l.prop, n * sizeof(T));
+		memcpy(actv, l.actv, n * sizeof(T));
+
+		if (!weights || !l.weights)
+			return;
+
+		memcpy(weights, l.weights, size() * stride * sizeof(T));
+
+		if (l.delta)  {
+			initDeltas();
+			memcpy(delta, l.delta, size() * stride * sizeof(T));
+			memcpy(prev_delta, l.prev_delta, size() * stride * sizeof(T));
+		}
 	}
 
-	size_t Layer::size() const  {
-		return elements.size();
+	template <typename T>
+	size_t BasicLayer<T>::size() const  {
+		return n_elements;
 	}
 
-	Neuron & Layer::operator[](size_t i) throw(NetworkIndexOutOfBoundsException)  {
+	template <typename T>
+	BasicNeuron<T> & BasicLayer<T>::operator[](size_t i) throw(NetworkIndexOutOfBoundsException)  {
 		if (i > size())
 			throw NetworkIndexOutOfBoundsException();
 
 		return elements[i];
 	}
 
-	void Layer::link(Layer& l) {
-		srand((unsigned) time(NULL));
-		
-		for (size_t i = 0; i < l.size(); i++)
-			l.elements[i].setSynOut(size());
-		
-		for (size_t i = 0; i < size(); i++)
-			elements[i].setSynIn(l.size());
-
-		for (size_t i = 0; i < l.size(); i++) {
-			for (size_t j = 0; j < size(); j++) {
-				Synapsis *s = new Synapsis( &(l.elements[i]), &(elements[i]), RAND, actv_f );
-				l.elements[i].synOut(j) = *s;
-				elements[j].synIn(i) = *s;
+	template <typename T>
+	void BasicLayer<T>::link(BasicLayer<T>& l) {
+		Random rng(Random::timeSeed());
+		link(l, rng);
+	}
+
+	template <typename T>
+	void BasicLayer<T>::link (BasicLayer<T>& l, Random& rng)  {
+		prev = &l;
+		l.next = this;
+
+		stride = padded<T>(l.size());
+		weights = mem->alloc<T>(size() * stride);
+		delta = NULL;
+		prev_delta = NULL;
+
+		for (size_t j = 0; j < size(); j++) {
+			for (size_t i = 0; i < l.size(); i++)
+				weights[j*stride + i] = 0.1 * rng.uniform();
+		}
+	}
+
+	template <typename T>
+	void BasicLayer<T>::link (BasicLayer<T>& l, T *w)  {
+		prev = &l;
+		l.next = this;
+
+		stride = padded<T>(l.size());
+		weights = w;
+		delta = NULL;
+		prev_delta = NULL;
+	}
+
+	template <typename T>
+	void BasicLayer<T>::initDeltas()  {
+		if (delta)
+			return;
+
+		mem->reserve(2 * Arena::padded(size() * stride * sizeof(T)));
+		delta = mem->alloc<T>(size() * stride);
+		prev_delta = mem->alloc<T>(size() * stride);
+	}
+
+	template <typename T>
+	void BasicLayer<T>::commitChanges (T rate, T beta) throw(InvalidSynapticalWeightException)  {
+		size_t n = (prev) ? prev->size() : 0;
+
+		if (!delta)
+			return;
+
+		for (size_t i = 0; i < size(); i++) {
+			T *w = weights + i*stride;
+			T *d = delta + i*stride;
+			T *pd = prev_delta + i*stride;
+
+			for (size_t j = 0; j < n; j++) {
+				T dw = rate * d[j] + beta * pd[j];
+
+				if (w[j] > 1.0)
+					throw InvalidSynapticalWeightException();
+
+				w[j] += dw;
+				pd[j] = dw;
+				d[j] = 0.0;
 			}
 		}
 	}
 
-	void Layer::setInput (vector<double> v)  {
+	template <typename T>
+	void BasicLayer<T>::setInput (const vector<T>& v)  {
+		setInput((v.empty()) ? NULL : &v[0], v.size());
+	}
+
+	template <typename T>
+	void BasicLayer<T>::setInput (const T *v, size_t n)  {
 		for (size_t i = 0; i < size(); i++)  {
-			elements[i].setProp(v[i]);
-			elements[i].setActv(v[i]);
+			prop[i] = (i < n) ? v[i] : 0.0;
+			actv[i] = prop[i];
 		}
 	}
 
-	void Layer::propagate() {
-		for (size_t i = 0; i < size(); i++)
-			elements[i].propagate();
+	template <typename T>
+	void BasicLayer<T>::propagateRows (size_t first, size_t last)  {
+		// Padding columns of both the weights and the input activations are
+		// zero, so the whole stride can be scanned
+		kernels::gemv(weights + first*stride, last - first, stride, stride,
+				prev->actv, prop + first);
+
+		for (size_t i = first; i < last; i++)  {
+			prop[i] -= threshold;
+			actv[i] = actv_f(prop[i]);
+		}
+	}
+
+	template <typename T>
+	void BasicLayer<T>::forward (const T *in, T *p, T *a) const  {
+		kernels::gemv(weights, size(), stride, stride, in, p);
+
+		for (size_t i = 0; i < size(); i++)  {
+			p[i] -= threshold;
+			a[i] = actv_f(p[i]);
+		}
 	}
+
+	template <typename T>
+	void BasicLayer<T>::addGradient (T *grad, T rate)  {
+		size_t n = size() * stride;
+
+		for (size_t i = 0; i < n; i++)  {
+			weights[i] += rate * grad[i];
+			grad[i] = 0.0;
+		}
+	}
+
+	template <typename T>
+	void BasicLayer<T>::propagateJob (void *arg, size_t part, size_t parts)  {
+		BasicLayer<T> *l = (BasicLayer<T>*) arg;
+
+		// Chunks of a multiple of 4 rows, the block size of the kernel
+		size_t chunk = ((l->size() + parts - 1) / parts + 3) & ~((size_t) 3);
+		size_t first = part * chunk;
+		size_t last = (first + chunk < l->size()) ? first + chunk : l->size();
+
+		if (first < last)
+			l->propagateRows(first, last);
+	}
+
+	template <typename T>
+	void BasicLayer<T>::propagate() {
+		if (!prev)
+			return;
+
+		if (pool && size() >= par_threshold)
+			pool->run(propagateJob, this);
+		else
+			propagateRows(0, size());
+	}
+
+	template <typename T>
+	void BasicLayer<T>::propagateBatch (const T *in, size_t ldin, size_t n, T *out, size_t ldout)  {
+		if (!prev)
+			return;
+
+		kernels::gemm(weights, size(), prev->size(), stride, in, ldin, n, out, ldout);
+
+		for (size_t s = 0; s < n; s++)  {
+			T *y = out + s*ldout;
+
+			for (size_t i = 0; i < size(); i++)
+				y[i] = actv_f(y[i] - threshold);
+		}
+	}
+
+	template class BasicLayer<double>;
+	template class BasicLayer<float>;
 }
 
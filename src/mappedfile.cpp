@@ -0,0 +1,92 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include <cstdio>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mappedfile.hpp"
+
+namespace neuralpp  {
+	MappedFile::MappedFile()  {
+		addr = NULL;
+		len = 0;
+	}
+
+	MappedFile::~MappedFile()  {
+		close();
+	}
+
+	bool MappedFile::open (const char *fname, bool writable)  {
+		close();
+
+		int fd = ::open(fname, O_RDONLY);
+
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+
+		if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)  {
+			::close(fd);
+			return false;
+		}
+
+		void *p = (writable) ?
+			mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) :
+			mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+		// The mapping keeps a reference to the file
+		::close(fd);
+
+		if (p == MAP_FAILED)
+			return false;
+
+		addr = p;
+		len = st.st_size;
+		return true;
+	}
+
+	void MappedFile::close()  {
+		if (addr)
+			munmap(addr, len);
+
+		addr = NULL;
+		len = 0;
+	}
+
+	char* MappedFile::data() const  {
+		return (char*) addr;
+	}
+
+	size_t MappedFile::size() const  {
+		return len;
+	}
+
+	std::string tempFile (const std::string& fname)  {
+		std::ostringstream s;
+		s << fname << ".tmp" << getpid();
+		return s.str();
+	}
+
+	bool replaceFile (const std::string& tmp, const std::string& fname)  {
+		if (!std::rename(tmp.c_str(), fname.c_str()))
+			return true;
+
+		std::remove(tmp.c_str());
+		return false;
+	}
+}
+
@@ -0,0 +1,84 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#ifndef __NEURALPP_MAPPEDFILE
+#define __NEURALPP_MAPPEDFILE
+
+#include <cstddef>
+#include <string>
+
+namespace neuralpp  {
+	/**
+	 * @class MappedFile
+	 * @brief Read-only memory mapping of a whole file. The content of the file is paged in
+	 *  by the system on demand, so opening even a large file takes no time and no memory
+	 *  but the page tables
+	 */
+	class MappedFile  {
+	public:
+		MappedFile();
+		~MappedFile();
+
+		/**
+		 * @brief Map a file, unmapping the one mapped before (if any)
+		 * @param fname Name of the file
+		 * @param writable If true, the mapping can be written too: the pages that are
+		 *  written are copied, and the file is never changed
+		 * @return false if the file couldn't be opened or mapped
+		 */
+		bool open (const char *fname, bool writable = false);
+
+		/**
+		 * @brief Unmap the file
+		 */
+		void close();
+
+		/**
+		 * @return Address the file is mapped at (aligned to a page), NULL if no file is mapped
+		 */
+		char* data() const;
+
+		/**
+		 * @return Size of the file in bytes
+		 */
+		size_t size() const;
+
+	private:
+		void *addr;
+		size_t len;
+
+		MappedFile (const MappedFile&);
+		MappedFile& operator= (const MappedFile&);
+	};
+
+	/**
+	 * @brief Name of a temporary file in the same directory as fname. Files that may be
+	 *  mapped are written there and then moved over fname through replaceFile(): truncating
+	 *  a mapped file would make the pages of the mapping past its new end unreadable
+	 * @param fname Name of the file to be written
+	 * @return Name of the temporary file
+	 */
+	std::string tempFile (const std::string& fname);
+
+	/**
+	 * @brief Atomically replace a file with a temporary one written through tempFile().
+	 *  The mappings of the old file stay valid, as they keep the old file alive
+	 * @param tmp Name of the temporary file, removed if it can't be renamed
+	 * @param fname Name of the file to be replaced
+	 * @return false if the file couldn't be replaced
+	 */
+	bool replaceFile (const std::string& tmp, const std::string& fname);
+}
+
+#endif
+
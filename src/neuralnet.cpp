@@ -11,17 +11,28 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
  **************************************************************************************************/
 
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <new>
 #include <sstream>
+#include <unistd.h>
+#include <sys/time.h>
 
 #include "neural++.hpp"
-#include "Markup.h"
+#include "arena.hpp"
+#include "mappedfile.hpp"
+#include "xmlscan.hpp"
+#include "threadpool.hpp"
 
 using std::vector;
 using std::string;
 using std::ifstream;
 using std::ofstream;
 using std::stringstream;
+using std::istringstream;
 
 namespace neuralpp {
 	double __actv(double prop)  {
@@ -33,36 +44,197 @@ namespace neuralpp {
 		return (f(x+h) - f(x)) / h;
 	}
 
-	NeuralNet::NeuralNet(size_t in_size, size_t hidden_size,
-			     size_t out_size, double l, int e, double th, double (*a)(double)) {
+	template <typename T>
+	BasicNeuralNet<T>::BasicNeuralNet()  {
+		input = hidden = output = NULL;
+		pool = NULL;
+		arena = NULL;
+		model = NULL;
+		train_threads = fwd_threads = 1;
+		train_sync = false;
+		par_size = 1024;
+	}
+
+	template <typename T>
+	BasicNeuralNet<T>::BasicNeuralNet(size_t in_size, size_t hidden_size,
+			     size_t out_size, T l, int e, T th, double (*a)(double), uint32_t seed) {
+		input = hidden = output = NULL;
+		pool = NULL;
+		arena = NULL;
+		model = NULL;
+		train_threads = fwd_threads = 1;
+		train_sync = false;
+		par_size = 1024;
+		init(in_size, hidden_size, out_size, l, e, th, a, seed);
+	}
+
+	template <typename T>
+	BasicNeuralNet<T>::BasicNeuralNet (const BasicNeuralNet<T>& net)  {
+		input = hidden = output = NULL;
+		pool = NULL;
+		arena = NULL;
+		model = NULL;
+		train_threads = fwd_threads = 1;
+		train_sync = false;
+		par_size = 1024;
+		*this = net;
+	}
+
+	template <typename T>
+	BasicNeuralNet<T>::~BasicNeuralNet()  {
+		destroy();
+		delete arena;
+	}
+
+	template <typename T>
+	BasicNeuralNet<T>& BasicNeuralNet<T>::operator= (const BasicNeuralNet<T>& net)  {
+		if (this == &net)
+			return *this;
+
+		train_threads = net.train_threads;
+		train_sync = net.train_sync;
+		fwd_threads = net.fwd_threads;
+		par_size = net.par_size;
+
+		if (!net.input)  {
+			destroy();
+			return *this;
+		}
+
+		init(net.input->size(), net.hidden->size(), net.output->size(),
+				net.l_rate, net.epochs, net.threshold, net.actv_f);
+
+		ref_epochs = net.ref_epochs;
+		batch_size = net.batch_size;
+		actv_df = net.actv_df;
+		expect = net.expect;
+
+		target_err = net.target_err;
+		min_improvement = net.min_improvement;
+		patience = net.patience;
+		max_time = net.max_time;
+
+		input->copyFrom(*net.input);
+		hidden->copyFrom(*net.hidden);
+		output->copyFrom(*net.output);
+		return *this;
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::init (size_t in_size, size_t hidden_size, size_t out_size, T l,
+			int e, T th, double (*a)(double), uint32_t seed)  {
+		Random rng((seed) ? seed : Random::timeSeed());
+
+		build(in_size, hidden_size, out_size, l, e, th, a, true);
+		link(rng);
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::build (size_t in_size, size_t hidden_size, size_t out_size, T l,
+			int e, T th, double (*a)(double), bool weights)  {
+		destroy();
+
+		if (!arena)
+			arena = new Arena;
 
 		epochs = e;
 		ref_epochs = epochs;
+		batch_size = 0;
 		l_rate = l;
 		actv_f = a;
+		actv_df = activation::derivative(a);
 		threshold = th;
 
-		input = new Layer(in_size, a, th);
-		hidden = new Layer(hidden_size, a, th);
-		output = new Layer(out_size, a, th);
-		link();
+		target_err = 0.0;
+		min_improvement = 0.0;
+		patience = 0;
+		max_time = 0.0;
+		stop = max_epochs;
+		trained_epochs = 0;
+
+		// One block for the layers, their neurons, their values and their weights
+		arena->reserve(3 * Arena::padded(sizeof(Layer)) +
+				Layer::footprint(in_size, 0) +
+				Layer::footprint(hidden_size, (weights) ? in_size : 0) +
+				Layer::footprint(out_size, (weights) ? hidden_size : 0));
+
+		input = new (arena->alloc<Layer>(1)) Layer(in_size, a, th, arena);
+		hidden = new (arena->alloc<Layer>(1)) Layer(hidden_size, a, th, arena);
+		output = new (arena->alloc<Layer>(1)) Layer(out_size, a, th, arena);
+		applyThreads();
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::applyThreads()  {
+		delete pool;
+		pool = (fwd_threads > 1) ? new ThreadPool(fwd_threads) : NULL;
+
+		input->pool = hidden->pool = output->pool = pool;
+		input->par_threshold = hidden->par_threshold = output->par_threshold = par_size;
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::destroy()  {
+		if (input)
+			input->~Layer();
+
+		if (hidden)
+			hidden->~Layer();
+
+		if (output)
+			output->~Layer();
+
+		input = hidden = output = NULL;
+
+		delete pool;
+		pool = NULL;
+
+		if (arena)
+			arena->release();
+
+		delete model;
+		model = NULL;
+	}
+
+	template <typename T>
+	double BasicNeuralNet<T>::deriv (double x, double fx) const  {
+		return (actv_df) ? actv_df(x, fx) : df(actv_f, x);
 	}
 
-	double NeuralNet::getOutput() const  {
+	template <typename T>
+	T BasicNeuralNet<T>::getOutput() const  {
 		return (*output)[0].getActv();
 	}
 
-	vector<double> NeuralNet::getOutputs() {
-		vector<double> v;
+	template <typename T>
+	T BasicNeuralNet<T>::getThreshold() const  {
+		return threshold;
+	}
 
-		for (size_t i = 0; i < output->size(); i++)
-			v.push_back((*output)[i].getActv());
-		return v;
+	template <typename T>
+	activation::function BasicNeuralNet<T>::getActivation() const  {
+		return actv_f;
+	}
+
+	template <typename T>
+	vector<T> BasicNeuralNet<T>::getOutputs() {
+		return vector<T>(output->actv, output->actv + output->size());
 	}
 
-	double NeuralNet::error(double expected)  {
-		double err = 0.0;
-		vector<double> out = getOutputs();
+	template <typename T>
+	size_t BasicNeuralNet<T>::getOutputs (T *out, size_t n) const  {
+		if (n > output->size())
+			n = output->size();
+
+		for (size_t i = 0; i < n; i++)
+			out[i] = output->actv[i];
+		return n;
+	}
+
+	template <typename T>
+	T BasicNeuralNet<T>::error(T expected)  {
+		T err = 0.0;
+		const T *out = output->actv;
 
 		for (size_t i=0; i < output->size(); i++)
 			err += 0.5*(out[i] - expect[i]) * (out[i] - expect[i]);
@@ -70,301 +242,681 @@ namespace neuralpp {
 		return err;
 	}
 
-	void NeuralNet::propagate() {
+	template <typename T>
+	void BasicNeuralNet<T>::propagate() {
 		hidden->propagate();
 		output->propagate();
 	}
 
-	void NeuralNet::setInput(vector<double> v) {
+	template <typename T>
+	void BasicNeuralNet<T>::propagateBatch (const T *in, size_t n, T *out)  {
+		// Samples are propagated in chunks, so that the activation values of the
+		// hidden layer for a chunk stay in cache
+		static const size_t CHUNK = 64;
+
+		size_t in_size = input->size(),
+			  out_size = output->size(),
+			  ld = output->stride;
+		vector<T> hid(CHUNK * ld);
+
+		for (size_t s = 0; s < n; s += CHUNK)  {
+			size_t m = (s + CHUNK < n) ? CHUNK : n - s;
+
+			hidden->propagateBatch(in + s*in_size, in_size, m, &hid[0], ld);
+			output->propagateBatch(&hid[0], ld, m, out + s*out_size, out_size);
+		}
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::setInput(const vector<T>& v) {
 		input->setInput(v);
 	}
 
-	void NeuralNet::link() {
-		hidden->link(*input);
-		output->link(*hidden);
+	template <typename T>
+	void BasicNeuralNet<T>::setInput (const T *v, size_t n)  {
+		input->setInput(v, n);
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::link (Random& rng)  {
+		hidden->link(*input, rng);
+		output->link(*hidden, rng);
 	}
 
-	void NeuralNet::setExpected(double e) {
+	template <typename T>
+	void BasicNeuralNet<T>::setExpected(T e) {
 		expect.clear();
 		expect.push_back(e);
 	}
 
-	void NeuralNet::setExpected(vector<double> e) {
+	template <typename T>
+	void BasicNeuralNet<T>::setExpected(vector<T> e) {
 		expect.clear();
 		expect.assign(e.begin(), e.end());
 	}
 
-	double NeuralNet::expected() const  {
+	template <typename T>
+	void BasicNeuralNet<T>::setExpected (const T *e, size_t n)  {
+		expect.assign(e, e + n);
+
+		if (expect.size() < output->size())
+			expect.resize(output->size(), 0.0);
+	}
+
+	template <typename T>
+	T BasicNeuralNet<T>::expected() const  {
 		return expect[0];
 	}
 
-	vector<double> NeuralNet::getExpected() const  {
+	template <typename T>
+	vector<T> BasicNeuralNet<T>::getExpected() const  {
 		return expect;
 	}
 
-	void NeuralNet::updateWeights() {
-		double Dk = 0.0;
+	template <typename T>
+	void BasicNeuralNet<T>::backPropagate (const T *x, const T *hprop, const T *hactv,
+			const T *oprop, const T *oactv, const T *ex,
+			T *gout, T *ghid) const  {
+		T Dk = 0.0;
 		size_t k = output->size();
+		size_t nhid = hidden->size();
+		size_t nin = input->size();
 
 		for (size_t i = 0; i < k; i++) {
-			Neuron *n = &(*output)[i];
-			double out_delta = 0.0,
-				  z = n->getActv(),
-				  d = expect[i],
-				  f = df(actv_f, n->getProp());
+			const T *w = output->weights + i*output->stride;
+			T *grad = gout + i*output->stride;
+			T z = oactv[i],
+				  d = ex[i],
+				  f = deriv(oprop[i], oactv[i]);
 	
-			for (size_t j = 0; j < n->nIn(); j++) {
-				Synapsis *s = &(n->synIn(j));
-				double y = s->getIn()->getActv(),
-					  beta = s->momentum(ref_epochs, ref_epochs - epochs);
-
-				if (ref_epochs - epochs > 0)
-					out_delta =
-					    (-l_rate) * (z-d) * f * y +
-					    beta * s->getPrevDelta();
-				else
-					out_delta =
-					    (-l_rate) * (z-d) * f * y;
+			for (size_t j = 0; j < nhid; j++) {
+				grad[j] += (z-d) * f * hactv[j];
+				Dk += ( (z-d) * f * w[j] );
+			}
+		}
 
-				Dk += ( (z-d) * f * s->getWeight() );
+		for (size_t i = 0; i < nhid; i++) {
+			T *grad = ghid + i*hidden->stride;
+			T d = deriv(hprop[i], hactv[i]) * Dk;
 
-				s->setDelta(out_delta);
-				(*hidden)[j].synOut(i).setDelta(out_delta);
-			}
+			for (size_t j = 0; j < nin; j++)
+				grad[j] += d * x[j];
 		}
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::accumulateGradients() {
+		output->initDeltas();
+		hidden->initDeltas();
 
-		for (size_t i = 0; i < hidden->size(); i++) {
-			Neuron *n = &(*hidden)[i];
-			double hidden_delta = 0.0,
-				  d = df(actv_f, n->getProp()) * Dk;
+		backPropagate(input->actv, hidden->prop, hidden->actv,
+				output->prop, output->actv, &expect[0],
+				output->delta, hidden->delta);
+	}
 
-			for (size_t j = 0; j < n->nIn(); j++) {
-				Synapsis *s = &(n->synIn(j));
-				double x = s->getIn()->getActv(),
-					  beta = s->momentum(ref_epochs, ref_epochs - epochs);
+	template <typename T>
+	void BasicNeuralNet<T>::applyGradients (size_t n, bool inertial)  {
+		T beta = (inertial) ? BasicSynapsis<T>::momentum(ref_epochs, ref_epochs - epochs) : 0.0;
 
-				if (ref_epochs - epochs > 0)
-					hidden_delta =
-						(-l_rate) * d * x +
-						beta * s->getPrevDelta();
-				else
-					hidden_delta =
-						(-l_rate) * d * x;
+		output->commitChanges(-l_rate / n, beta);
+		hidden->commitChanges(-l_rate / n, beta);
+	}
 
-				s->setDelta(hidden_delta);
-				(*input)[j].synOut(i).setDelta(hidden_delta);
-			}
+	template <typename T>
+	void BasicNeuralNet<T>::updateWeights() {
+		accumulateGradients();
+		applyGradients(1, ref_epochs - epochs > 0);
+	}
+
+	/**
+	 * Wall-clock time in seconds
+	 */
+	static double now()  {
+		struct timeval tv;
+		gettimeofday(&tv, NULL);
+		return tv.tv_sec + tv.tv_usec * 1e-6;
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::startTraining()  {
+		deadline = (max_time > 0.0) ? now() + max_time : 0.0;
+		trained_epochs = 0;
+		stop = max_epochs;
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::startLoop()  {
+		best_err = -1.0;
+		stale_epochs = 0;
+		stop = max_epochs;
+	}
+
+	template <typename T>
+	bool BasicNeuralNet<T>::stopping (T err)  {
+		trained_epochs++;
+
+		if (target_err > 0.0 && err <= target_err)  {
+			stop = target_error;
+			return true;
 		}
 
-		for (size_t i = 0; i < output->size(); i++) {
-			Neuron *n = &((*output)[i]);
+		if (best_err < 0.0 || err < best_err * (1.0 - min_improvement))  {
+			best_err = err;
+			stale_epochs = 0;
+		} else if (patience && ++stale_epochs >= patience)  {
+			stop = no_improvement;
+			return true;
+		}
 
-			for (size_t j = 0; j < n->nIn(); j++) {
-				Synapsis *s = &(n->synIn(j));
-				s->setWeight(s->getWeight() +
-					     s->getDelta());
-				s->setDelta(0.0);
-			}
+		if (deadline > 0.0 && now() >= deadline)  {
+			stop = time_limit;
+			return true;
 		}
 
-		for (size_t i = 0; i < hidden->size(); i++) {
-			Neuron *n = &((*hidden)[i]);
+		return false;
+	}
 
-			for (size_t j = 0; j < n->nOut(); j++) {
-				Synapsis *s = &(n->synOut(j));
-				s->setWeight(s->getWeight() +
-					     s->getDelta());
-				s->setDelta(0.0);
-			}
+	template <typename T>
+	void BasicNeuralNet<T>::update() {
+		epochs = ref_epochs;
+		startLoop();
+
+		while ((epochs--) > 0) {
+			propagate();
+
+			T err = error(expected());
+			updateWeights();
+
+			if (stopping(err))
+				break;
 		}
+	}
 
-		for (size_t i = 0; i < hidden->size(); i++) {
-			Neuron *n = &((*hidden)[i]);
+	template <typename T>
+	void BasicNeuralNet<T>::updateBatches (const BasicTrainingSet<T>& set)  {
+		size_t n = set.size();
+		bool inertial = false;
 
-			for (size_t j = 0; j < n->nIn(); j++) {
-				Synapsis *s = &(n->synIn(j));
-				s->setWeight(s->getWeight() +
-					     s->getDelta());
-				s->setDelta(0.0);
+		epochs = ref_epochs;
+		startLoop();
+
+		while ((epochs--) > 0) {
+			T err = 0.0;
+
+			for (size_t first = 0; first < n; first += batch_size)  {
+				size_t last = (first + batch_size < n) ? first + batch_size : n;
+
+				for (size_t i = first; i < last; i++)  {
+					setInput(set.input(i), set.inputSize());
+					setExpected(set.target(i), set.outputSize());
+					propagate();
+					err += error(expected());
+					accumulateGradients();
+				}
+
+				applyGradients(last - first, inertial);
+				inertial = true;
 			}
-		}
 
-		for (size_t i = 0; i < input->size(); i++) {
-			Neuron *n = &((*input)[i]);
+			if (n && stopping(err / n))
+				break;
+		}
+	}
 
-			for (size_t j = 0; j < n->nOut(); j++) {
-				Synapsis *s = &(n->synOut(j));
-				s->setWeight(s->getWeight() +
-					     s->getDelta());
-				s->setDelta(0.0);
+	/**
+	 * Private buffers of a thread for parallel training
+	 */
+	template <typename T>
+	struct workspace  {
+		vector<T> x, y;
+		vector<T> hprop, hactv;
+		vector<T> oprop, oactv;
+		vector<T> gout, ghid;
+		T err;
+	};
+
+	/**
+	 * Description of the job of the training threads
+	 */
+	template <typename T>
+	struct trainjob  {
+		BasicNeuralNet<T> *net;
+		const BasicTrainingSet<T> *set;
+		vector< workspace<T> > *ws;
+		size_t first;
+		size_t last;
+		bool hogwild;
+	};
+
+	template <typename T>
+	void BasicNeuralNet<T>::trainJob (void *arg, size_t part, size_t parts)  {
+		trainjob<T> *job = (trainjob<T>*) arg;
+		BasicNeuralNet<T> *net = job->net;
+		workspace<T>& w = (*job->ws)[part];
+		size_t nin = job->set->inputSize();
+		size_t nout = job->set->outputSize();
+
+		if (nin > net->input->size())
+			nin = net->input->size();
+
+		if (nout > net->output->size())
+			nout = net->output->size();
+
+		// Samples are dealt to the threads in round robin
+		for (size_t i = job->first + part; i < job->last; i += parts)  {
+			const T *in = job->set->input(i);
+			const T *out = job->set->target(i);
+
+			// Targets are padded with zeros like setExpected() does
+			for (size_t j = 0; j < nin; j++)
+				w.x[j] = in[j];
+
+			for (size_t j = 0; j < nout; j++)
+				w.y[j] = out[j];
+
+			net->hidden->forward(&w.x[0], &w.hprop[0], &w.hactv[0]);
+			net->output->forward(&w.hactv[0], &w.oprop[0], &w.oactv[0]);
+
+			for (size_t j = 0; j < w.oactv.size(); j++)
+				w.err += 0.5 * (w.oactv[j] - w.y[j]) * (w.oactv[j] - w.y[j]);
+
+			net->backPropagate(&w.x[0], &w.hprop[0], &w.hactv[0],
+					&w.oprop[0], &w.oactv[0], &w.y[0],
+					&w.gout[0], &w.ghid[0]);
+
+			if (job->hogwild)  {
+				net->output->addGradient(&w.gout[0], -net->l_rate);
+				net->hidden->addGradient(&w.ghid[0], -net->l_rate);
 			}
 		}
 	}
 
-	void NeuralNet::update() {
+	template <typename T>
+	void BasicNeuralNet<T>::updateParallel (const BasicTrainingSet<T>& set)  {
+		// The pool of the forward pass is reused if it has the right size
+		// A pool created here is freed on return, and also when training throws
+		struct poolguard  {
+			ThreadPool *p;
+			~poolguard()  { delete p; }
+		} own;
+
+		own.p = (pool && pool->size() == train_threads) ? NULL : new ThreadPool(train_threads);
+		ThreadPool& threads = (own.p) ? *own.p : *pool;
+		size_t parts = threads.size();
+		size_t n = set.size();
+		size_t batch = (train_sync) ? ((batch_size) ? batch_size : parts) : n;
+		bool inertial = false;
+
+		vector< workspace<T> > ws(parts);
+		trainjob<T> job;
+
+		for (size_t p = 0; p < parts; p++)  {
+			ws[p].x = vector<T>(hidden->stride);
+			ws[p].y = vector<T>(output->size());
+			ws[p].hprop = vector<T>(output->stride);
+			ws[p].hactv = vector<T>(output->stride);
+			ws[p].oprop = vector<T>(output->size());
+			ws[p].oactv = vector<T>(output->size());
+			ws[p].gout = vector<T>(output->size() * output->stride);
+			ws[p].ghid = vector<T>(hidden->size() * hidden->stride);
+			ws[p].err = 0.0;
+		}
+
+		job.net = this;
+		job.set = &set;
+		job.ws = &ws;
+		job.hogwild = !train_sync;
+
+		output->initDeltas();
+		hidden->initDeltas();
 		epochs = ref_epochs;
+		startLoop();
 
 		while ((epochs--) > 0) {
-			propagate();
-			updateWeights();
+			T err = 0.0;
+
+			for (size_t first = 0; first < n; first += batch)  {
+				job.first = first;
+				job.last = (first + batch < n) ? first + batch : n;
+				threads.run(trainJob, &job);
+
+				if (job.hogwild)
+					continue;
+
+				// Reduce the gradients of the threads always in the same
+				// order, so that the result is deterministic
+				for (size_t p = 0; p < parts; p++)  {
+					for (size_t i = 0; i < ws[p].gout.size(); i++)  {
+						output->delta[i] += ws[p].gout[i];
+						ws[p].gout[i] = 0.0;
+					}
+
+					for (size_t i = 0; i < ws[p].ghid.size(); i++)  {
+						hidden->delta[i] += ws[p].ghid[i];
+						ws[p].ghid[i] = 0.0;
+					}
+				}
+
+				applyGradients(job.last - first, inertial);
+				inertial = true;
+			}
+
+			for (size_t p = 0; p < parts; p++)  {
+				err += ws[p].err;
+				ws[p].err = 0.0;
+			}
+
+			if (n && stopping(err / n))
+				break;
 		}
 	}
 
-	void NeuralNet::save (const char *fname) throw(NetworkFileWriteException)  {
-		ofstream out(fname);
-		stringstream xml(stringstream::in | stringstream::out);
+	template <typename T>
+	void BasicNeuralNet<T>::setTrainingThreads (size_t n, training_mode mode)  {
+		if (!n)
+			n = sysconf(_SC_NPROCESSORS_ONLN);
 
-		if (!out)
-			throw NetworkFileWriteException();
+		train_threads = n;
+		train_sync = (mode == synchronous);
+	}
 
-		xml << "<?xml version=\"1.0\" encoding=\"iso-8859-1\"?>\n"
-			<< "<!DOCTYPE NETWORK SYSTEM \"http://blacklight.gotdns.org/prog/neuralpp/network.dtd\">\n"
-			<< "<!-- Automatically generated by BlackLight's Neural++ module -->\n\n"
-			<< "<network name=\"Put here the name for this neural network\" epochs=\"" << ref_epochs << "\" "
-			<< "learning_rate=\"" << l_rate << "\" threshold=\"" << threshold << "\">\n"
-			<< "\t<layer class=\"input\"  size=\"" << input->size()  << "\"></layer>\n"
-			<< "\t<layer class=\"hidden\" size=\"" << hidden->size() << "\"></layer>\n"
-			<< "\t<layer class=\"output\" size=\"" << output->size() << "\"></layer>\n\n";
+	template <typename T>
+	void BasicNeuralNet<T>::setBatchSize (size_t n)  {
+		batch_size = n;
+	}
 
-		for (unsigned int i = 0; i < hidden->size(); i++) {
-			int nin = (*hidden)[i].nIn();
+	template <typename T>
+	void BasicNeuralNet<T>::setTargetError (T e)  {
+		target_err = e;
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::setPatience (size_t epochs, T min_improvement)  {
+		patience = epochs;
+		this->min_improvement = min_improvement;
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::setTimeLimit (double seconds)  {
+		max_time = seconds;
+	}
+
+	template <typename T>
+	typename BasicNeuralNet<T>::stop_reason BasicNeuralNet<T>::getStopReason() const  {
+		return stop;
+	}
+
+	template <typename T>
+	size_t BasicNeuralNet<T>::getTrainedEpochs() const  {
+		return trained_epochs;
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::setThreads (size_t n, size_t min_size)  {
+		if (!n)
+			n = sysconf(_SC_NPROCESSORS_ONLN);
+
+		fwd_threads = n;
+		par_size = min_size;
+
+		// Without layers the setting is only stored, build() applies it
+		if (input)
+			applyThreads();
+	}
+
+	/**
+	 * Size the buffer of save() reaches before being written to the file
+	 */
+	static const size_t SAVE_BUFFER = 256 * 1024;
+
+	template <typename T>
+	void BasicNeuralNet<T>::save (const char *fname, bool hex) throw(NetworkFileWriteException)  {
+		// The weights may be mapped from fname by loadModel(), so the file is
+		// written aside and renamed over fname only when it's complete
+		string tmp = tempFile(fname);
+		ofstream out(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		bool single = (sizeof(T) == sizeof(float));
+		string xml;
+		char num[16];
+
+		if (!out)
+			throw NetworkFileWriteException();
 
-			for (int j = 0; j < nin; j++)
-				xml << "\t<synapsis class=\"inhid\" input=\"" << j << "\" output=\"" << i << "\" "
-					<< "weight=\"" << (*hidden)[i].synIn(j).getWeight() << "\"></synapsis>\n";
+		xml.reserve(SAVE_BUFFER + 256);
+		sprintf(num, "%d", ref_epochs);
+
+		xml += "<?xml version=\"1.0\" encoding=\"iso-8859-1\"?>\n"
+			"<!DOCTYPE NETWORK SYSTEM \"http://blacklight.gotdns.org/prog/neuralpp/network.dtd\">\n"
+			"<!-- Automatically generated by BlackLight's Neural++ module -->\n\n"
+			"<network name=\"Put here the name for this neural network\" epochs=\"";
+		xml += num;
+		xml += "\" learning_rate=\"";
+		xmlscan::appendReal(xml, l_rate, single);
+		xml += "\" threshold=\"";
+		xmlscan::appendReal(xml, threshold, single);
+		xml += "\">\n\t<layer class=\"input\"  size=\"";
+		xmlscan::appendUnsigned(xml, input->size());
+		xml += "\"></layer>\n\t<layer class=\"hidden\" size=\"";
+		xmlscan::appendUnsigned(xml, hidden->size());
+		xml += "\"></layer>\n\t<layer class=\"output\" size=\"";
+		xmlscan::appendUnsigned(xml, output->size());
+		xml += "\"></layer>\n\n";
+
+		Layer *layers[] = { hidden, output };
+		const char *classes[] = { "\t<synapsis class=\"inhid\" input=\"", "\t<synapsis class=\"hidout\" input=\"" };
+
+		for (size_t l = 0; l < 2; l++)  {
+			Layer *layer = layers[l];
+			size_t nin = layer->prev->size();
+
+			for (size_t i = 0; i < layer->size(); i++)  {
+				const T *w = layer->weights + i * layer->stride;
+
+				for (size_t j = 0; j < nin; j++)  {
+					xml += classes[l];
+					xmlscan::appendUnsigned(xml, j);
+					xml += "\" output=\"";
+					xmlscan::appendUnsigned(xml, i);
+					xml += "\" weight=\"";
+
+					if (hex)
+						xmlscan::appendHex(xml, w[j]);
+					else
+						xmlscan::appendReal(xml, w[j], single);
+
+					xml += "\"></synapsis>\n";
+
+					if (xml.size() >= SAVE_BUFFER)  {
+						out.write(xml.data(), xml.size());
+						xml.clear();
+					}
+				}
+			}
 		}
 
-		for (unsigned int i = 0; i < output->size(); i++) {
-			int nin = (*output)[i].nIn();
+		xml += "</network>\n";
+		out.write(xml.data(), xml.size());
+		out.close();
 
-			for (int j = 0; j < nin; j++)
-				xml << "\t<synapsis class=\"hidout\" input=\"" << j << "\" output=\"" << i << "\" "
-					<< "weight=\"" << (*output)[i].synIn(j).getWeight() << "\"></synapsis>\n";
+		if (out.fail())  {
+			std::remove(tmp.c_str());
+			throw NetworkFileWriteException();
 		}
 
-		xml << "</network>\n";
-		out << xml.str();
+		if (!replaceFile(tmp, fname))
+			throw NetworkFileWriteException();
 	}
 
-	NeuralNet::NeuralNet(const string fname) throw(NetworkFileNotFoundException)  {
-		unsigned int in_size = 0, hid_size = 0, out_size = 0;
-		vector< vector<double> > in_hid_synapses, hid_out_synapses;
+	template <typename T>
+	BasicNeuralNet<T>::BasicNeuralNet(const string fname)
+		throw(NetworkFileNotFoundException, InvalidXMLException)  {
+		MappedFile xml;
 
-		CMarkup xml;
-		xml.Load(fname.c_str());
+		input = hidden = output = NULL;
+		pool = NULL;
+		arena = NULL;
+		model = NULL;
+		train_threads = fwd_threads = 1;
+		train_sync = false;
+		par_size = 1024;
 
-		if (!xml.IsWellFormed()) {
-			throw InvalidXMLException("Malformed XML");
-			return;
+		if (!xml.open(fname.c_str()))
+			throw NetworkFileNotFoundException();
+
+		try  {
+			loadXML(xml.data(), xml.data() + xml.size());
+		} catch (InvalidXMLException& e)  {
+			destroy();
+			delete arena;
+			throw;
 		}
+	}
 
-		if (xml.FindElem("network")) {
-			if (xml.GetAttrib("epochs").empty())
-				throw InvalidXMLException("'epochs' parameter not defined");
-			
-			if (xml.GetAttrib("learning_rate").empty())
-				throw InvalidXMLException("'learning_rate' parameter not defined");
+	template <typename T>
+	void BasicNeuralNet<T>::buildZero (size_t in_size, size_t hidden_size, size_t out_size,
+			T l, int e, T th)  {
+		build(in_size, hidden_size, out_size, l, e, th, __actv, true);
+		hidden->link(*input, arena->alloc<T>(hidden_size * Layer::rowStride(in_size)));
+		output->link(*hidden, arena->alloc<T>(out_size * Layer::rowStride(hidden_size)));
+	}
 
-			epochs = atoi(xml.GetAttrib("epochs").c_str());
-			l_rate = atof(xml.GetAttrib("learning_rate").c_str());
-			threshold = 0.0;
-			
-			if (!xml.GetAttrib("threshold").empty())
-				threshold = atof(xml.GetAttrib("threshold").c_str());
+	/**
+	 * Get an attribute of a tag that must have a non-empty value
+	 */
+	static const char* xmlRequire (const char *p, const char *end, const char *name,
+			const char *err) throw(InvalidXMLException)  {
+		const char *v = xmlscan::attrib(p, end, name);
 
-			while (xml.FindChildElem("layer"))  {
-				if (xml.GetChildAttrib("class").empty())
-					throw InvalidXMLException("'layer' tag with no class specified");
-			
-				if (xml.GetChildAttrib("size").empty())
-					throw InvalidXMLException("'layer' tag without size specification");
-
-				if (!xml.GetChildAttrib("class").compare("input"))
-					in_size = atoi(xml.GetChildAttrib("size").c_str());
-				else if (!xml.GetChildAttrib("class").compare("hidden"))
-					hid_size = atoi(xml.GetChildAttrib("size").c_str());
-				else if (!xml.GetChildAttrib("class").compare("output"))
-					out_size = atoi(xml.GetChildAttrib("size").c_str());
-				else
-					throw InvalidXMLException("Invalid attribute inside 'layer' tag");
-			}
+		if (!v || *v == v[-1])
+			throw InvalidXMLException(err);
 
-			if (in_size && hid_size && out_size)  {
-				in_hid_synapses = vector< vector<double> >(in_size);
+		return v;
+	}
 
-				for (unsigned int i=0; i < in_size; i++)
-					in_hid_synapses[i] = vector<double>(hid_size);
+	template <typename T>
+	void BasicNeuralNet<T>::loadXML (const char *p, const char *end) throw(InvalidXMLException)  {
+		size_t in_size = 0, hid_size = 0, out_size = 0;
+		bool found = false;
+		int e = 0;
+		T l = 0.0, th = 0.0;
+
+		// The file is only read inside complete tags, whose closing '>' stops
+		// the number conversions
+		for (const char *tag; (tag = (const char*) memchr(p, '<', end - p)); )  {
+			size_t len = xmlscan::markupEnd(tag, end - tag);
+
+			if (!len)
+				throw InvalidXMLException("Malformed XML");
+
+			p = tag + len;
+
+			if (tag[1] == '!' || tag[1] == '?' || tag[1] == '/')
+				continue;
+
+			const char *name = tag + 1;
+			const char *attr = name;
+			const char *tag_end = p - 1;
+
+			while (attr < tag_end && *attr != '/' && !isspace((unsigned char) *attr))
+				attr++;
+
+			size_t n = attr - name;
+
+			if (n == 7 && !strncmp(name, "network", n))  {
+				e = atoi(xmlRequire(attr, tag_end, "epochs", "'epochs' parameter not defined"));
+				l = strtod(xmlRequire(attr, tag_end, "learning_rate",
+							"'learning_rate' parameter not defined"), NULL);
+
+				const char *v = xmlscan::attrib(attr, tag_end, "threshold");
+				th = (v) ? strtod(v, NULL) : 0.0;
+				found = true;
+			} else if (!found)
+				continue;
+			else if (n == 5 && !strncmp(name, "layer", n))  {
+				const char *c = xmlRequire(attr, tag_end, "class", "'layer' tag with no class specified");
+				size_t sz = atoi(xmlRequire(attr, tag_end, "size",
+							"'layer' tag without size specification"));
+
+				if (xmlscan::valueIs(c, "input"))
+					in_size = sz;
+				else if (xmlscan::valueIs(c, "hidden"))
+					hid_size = sz;
+				else if (xmlscan::valueIs(c, "output"))
+					out_size = sz;
+				else
+					throw InvalidXMLException("Invalid attribute inside 'layer' tag");
+			} else if (n == 8 && !strncmp(name, "synapsis", n))  {
+				if (!input)  {
+					if (!(in_size && hid_size && out_size))
+						throw InvalidXMLException("In your XML all the specifications about input, hidden and output layers should be present before defining a synapsis");
 
-				hid_out_synapses = vector< vector<double> >(hid_size);
+					buildZero(in_size, hid_size, out_size, l, e, th);
+				}
 
-				for (unsigned int i=0; i < hid_size; i++)
-					hid_out_synapses[i] = vector<double>(out_size);
-			} else
-				throw InvalidXMLException ("In your XML all the specifications about input, hidden and output layers should be present");
-			
-			while (xml.FindChildElem("synapsis"))  {
-				if (!(in_size && hid_size && out_size))
-					throw InvalidXMLException("In your XML all the specifications about input, hidden and output layers should be present before defining a synapsis");
+				// All the attributes are read in a single pass
+				const char *c = NULL, *in_v = NULL, *out_v = NULL, *w_v = NULL;
+				const char *a_name, *v;
+				size_t a_len;
+
+				for (const char *a = attr; (a = xmlscan::nextAttrib(a, tag_end, a_name, a_len, v)); )  {
+					if (*v == v[-1])
+						continue;
+
+					if (a_len == 5 && !strncmp(a_name, "class", 5))
+						c = v;
+					else if (a_len == 5 && !strncmp(a_name, "input", 5))
+						in_v = v;
+					else if (a_len == 6 && !strncmp(a_name, "output", 6))
+						out_v = v;
+					else if (a_len == 6 && !strncmp(a_name, "weight", 6))
+						w_v = v;
+				}
 
-				if (xml.GetChildAttrib("class").empty())
+				if (!c)
 					throw InvalidXMLException("'synapsis' tag with no class specified");
-			
-				if (xml.GetChildAttrib("input").empty())
+
+				if (!in_v)
 					throw InvalidXMLException("'synapsis' tag with no input neuron specified");
-				
-				if (xml.GetChildAttrib("output").empty())
+
+				if (!out_v)
 					throw InvalidXMLException("'synapsis' tag with no output neuron specified");
-				
-				if (xml.GetChildAttrib("weight").empty())
+
+				if (!w_v)
 					throw InvalidXMLException("'synapsis' tag with no weight specified");
 
-				unsigned int in  = atoi(xml.GetChildAttrib("input").c_str());
-				unsigned int out = atoi(xml.GetChildAttrib("output").c_str());
+				size_t in = atoi(in_v);
+				size_t out = atoi(out_v);
+				T w = strtod(w_v, NULL);
 
-				if (xml.GetChildAttrib("class") == "inhid")  {
-					if (in >= in_size || out >= hid_size)
-						throw InvalidXMLException("The id of the input or output neuron is greater than the size of the layer");
+				Layer *layer = NULL;
 
-					in_hid_synapses[in][out] = atof(xml.GetChildAttrib("weight").c_str());
-				}
+				if (xmlscan::valueIs(c, "inhid"))
+					layer = hidden;
+				else if (xmlscan::valueIs(c, "hidout"))
+					layer = output;
 
-				if (xml.GetChildAttrib("class") == "hidout")  {
-					if (in >= hid_size || out >= out_size)
-						throw InvalidXMLException("The id of the input or output neuron is greater than the size of the layer");
+				if (!layer)
+					continue;
 
-					hid_out_synapses[in][out] = atof(xml.GetChildAttrib("weight").c_str());
-				}
-			}
-		}
+				if (in >= layer->prev->size() || out >= layer->size())
+					throw InvalidXMLException("The id of the input or output neuron is greater than the size of the layer");
 
-		*this = NeuralNet(in_size, hid_size, out_size, l_rate, epochs, threshold);
-
-		hidden->link(*input);
-		output->link(*hidden);
-
-		// Restore synapses
-		for (unsigned int i = 0; i < input->size(); i++) {
-			for (unsigned int j = 0; j < hidden->size(); j++)
-				(*input)[i].synOut(j).setWeight( in_hid_synapses[i][j] );
+				layer->weights[out * layer->stride + in] = w;
+			}
 		}
 
-		for (unsigned int i = 0; i < output->size(); i++) {
-			for (unsigned int j = 0; j < hidden->size(); j++)
-				(*output)[i].synIn(j).setWeight( (hid_out_synapses[j][i]) );
-		}
+		if (!found)
+			throw InvalidXMLException("No 'network' tag specified");
 
-		for (unsigned int i = 0; i < hidden->size(); i++) {
-			for (unsigned int j = 0; j < input->size(); j++)
-				(*hidden)[i].synIn(j).setWeight( (in_hid_synapses[j][i]) );
-		}
+		if (!(in_size && hid_size && out_size))
+			throw InvalidXMLException ("In your XML all the specifications about input, hidden and output layers should be present");
 
-		for (unsigned int i = 0; i < hidden->size(); i++) {
-			for (unsigned int j = 0; j < output->size(); j++)
-				(*hidden)[i].synOut(j).setWeight( hid_out_synapses[i][j] );
-		}
+		if (!input)
+			buildZero(in_size, hid_size, out_size, l, e, th);
 	}
 
-	void NeuralNet::saveToBinary (const char *fname) throw(NetworkFileWriteException)  {
+	template <typename T>
+	void BasicNeuralNet<T>::saveToBinary (const char *fname) throw(NetworkFileWriteException)  {
 		struct netrecord record;
 		ofstream out(fname);
 
@@ -379,7 +931,7 @@ namespace neuralpp {
 		record.l_rate = l_rate;
 		record.ex = expect[0];
 
-		if (out.write((char*) &record, sizeof(struct netrecord)) <= 0)
+		if (!out.write((char*) &record, sizeof(struct netrecord)))
 			throw NetworkFileWriteException();
 
 		// Saving neurons' state
@@ -388,7 +940,7 @@ namespace neuralpp {
 			r.prop = (*input)[i].getProp();
 			r.actv = (*input)[i].getActv();
 
-			if (out.write((char*) &r, sizeof(struct neuronrecord)) <= 0)
+			if (!out.write((char*) &r, sizeof(struct neuronrecord)))
 				throw NetworkFileWriteException();
 		}
 
@@ -397,7 +949,7 @@ namespace neuralpp {
 			r.prop = (*hidden)[i].getProp();
 			r.actv = (*hidden)[i].getActv();
 			
-			if (out.write((char*) &r, sizeof(struct neuronrecord)) <= 0)
+			if (!out.write((char*) &r, sizeof(struct neuronrecord)))
 				throw NetworkFileWriteException();
 		}
 
@@ -406,7 +958,7 @@ namespace neuralpp {
 			r.prop = (*output)[i].getProp();
 			r.actv = (*output)[i].getActv();
 
-			if (out.write((char*) &r, sizeof(struct neuronrecord)) <= 0)
+			if (!out.write((char*) &r, sizeof(struct neuronrecord)))
 				throw NetworkFileWriteException();
 		}
 
@@ -414,7 +966,7 @@ namespace neuralpp {
 		for (unsigned int i = 0; i < input->size(); i++) {
 			int nout = (*input)[i].nOut();
 
-			if (out.write((char*) &nout, sizeof(int)) <= 0)
+			if (!out.write((char*) &nout, sizeof(int)))
 				throw NetworkFileWriteException();
 
 			for (int j = 0; j < nout; j++) {
@@ -422,7 +974,7 @@ namespace neuralpp {
 				r.w = (*input)[i].synOut(j).getWeight();
 				r.d = (*input)[i].synOut(j).getDelta();
 
-				if (out.write((char*) &r, sizeof(struct synrecord)) <= 0)
+				if (!out.write((char*) &r, sizeof(struct synrecord)))
 					throw NetworkFileWriteException();
 			}
 		}
@@ -430,7 +982,7 @@ namespace neuralpp {
 		for (unsigned int i = 0; i < output->size(); i++) {
 			int nin = (*output)[i].nIn();
 
-			if (out.write((char*) &nin, sizeof(int)) <= 0)
+			if (!out.write((char*) &nin, sizeof(int)))
 				throw NetworkFileWriteException();
 			
 			for (int j = 0; j < nin; j++) {
@@ -438,7 +990,7 @@ namespace neuralpp {
 				r.w = (*output)[i].synIn(j).getWeight();
 				r.d = (*output)[i].synIn(j).getDelta();
 
-				if (out.write((char*) &r, sizeof(struct synrecord)) <= 0)
+				if (!out.write((char*) &r, sizeof(struct synrecord)))
 					throw NetworkFileWriteException();
 			}
 		}
@@ -446,7 +998,7 @@ namespace neuralpp {
 		for (unsigned int i = 0; i < hidden->size(); i++) {
 			int nin = (*hidden)[i].nIn();
 
-			if (out.write((char*) &nin, sizeof(int)) <= 0)
+			if (!out.write((char*) &nin, sizeof(int)))
 				throw NetworkFileWriteException();
 
 			for (int j = 0; j < nin; j++) {
@@ -454,7 +1006,7 @@ namespace neuralpp {
 				r.w = (*hidden)[i].synIn(j).getWeight();
 				r.d = (*hidden)[i].synIn(j).getDelta();
 
-				if (out.write((char*) &r, sizeof(struct synrecord)) <= 0)
+				if (!out.write((char*) &r, sizeof(struct synrecord)))
 					throw NetworkFileWriteException();
 			}
 		}
@@ -462,7 +1014,7 @@ namespace neuralpp {
 		for (unsigned int i = 0; i < hidden->size(); i++) {
 			int nout = (*hidden)[i].nOut();
 
-			if (out.write((char*) &nout, sizeof(int)) <= 0)
+			if (!out.write((char*) &nout, sizeof(int)))
 				throw NetworkFileWriteException();
 
 			for (int j = 0; j < nout; j++) {
@@ -470,7 +1022,7 @@ namespace neuralpp {
 				r.w = (*hidden)[i].synOut(j).getWeight();
 				r.d = (*hidden)[i].synOut(j).getDelta();
 
-				if (out.write((char*) &r, sizeof(struct synrecord)) <= 0)
+				if (!out.write((char*) &r, sizeof(struct synrecord)))
 					throw NetworkFileWriteException();
 			}
 		}
@@ -478,78 +1030,62 @@ namespace neuralpp {
 		out.close();
 	}
 
-	void NeuralNet::loadFromBinary (const string fname) throw(NetworkFileNotFoundException) {
+	template <typename T>
+	void BasicNeuralNet<T>::loadFromBinary (const string fname) throw(NetworkFileNotFoundException) {
 		struct netrecord record;
 		ifstream in(fname.c_str());
 
 		if (!in)
 			throw NetworkFileNotFoundException();
 
-		if (in.read((char*) &record, sizeof(struct netrecord)) <= 0)
+		if (!in.read((char*) &record, sizeof(struct netrecord)))
 			throw NetworkFileNotFoundException();
 
-		*this =
-		    NeuralNet(record.input_size, record.hidden_size,
-			      record.output_size, record.l_rate,
-			      record.epochs);
+		init(record.input_size, record.hidden_size, record.output_size,
+				record.l_rate, record.epochs, 0.0, __actv);
 
 		// Restore neurons
 		for (unsigned int i = 0; i < input->size(); i++) {
 			struct neuronrecord r;
 
-			if (in.read((char*) &r, sizeof(struct neuronrecord)) <= 0)
+			if (!in.read((char*) &r, sizeof(struct neuronrecord)))
 				throw NetworkFileNotFoundException();
 
 			(*input)[i].setProp(r.prop);
 			(*input)[i].setActv(r.actv);
-			(*input)[i].synClear();
 		}
 
 		for (unsigned int i = 0; i < hidden->size(); i++) {
 			struct neuronrecord r;
 			
-			if (in.read((char*) &r, sizeof(struct neuronrecord)) <= 0)
+			if (!in.read((char*) &r, sizeof(struct neuronrecord)))
 				throw NetworkFileNotFoundException();
 
 			(*hidden)[i].setProp(r.prop);
 			(*hidden)[i].setActv(r.actv);
-			(*hidden)[i].synClear();
 		}
 
 		for (unsigned int i = 0; i < output->size(); i++) {
 			struct neuronrecord r;
 			
-			if (in.read((char*) &r, sizeof(struct neuronrecord)) <= 0)
+			if (!in.read((char*) &r, sizeof(struct neuronrecord)))
 				throw NetworkFileNotFoundException();
 
 			(*output)[i].setProp(r.prop);
 			(*output)[i].setActv(r.actv);
-			(*output)[i].synClear();
 		}
 
-		for (unsigned int i = 0; i < input->size(); i++)
-			(*input)[i].synClear();
-
-		for (unsigned int i = 0; i < hidden->size(); i++)
-			(*hidden)[i].synClear();
-
-		for (unsigned int i = 0; i < output->size(); i++)
-			(*output)[i].synClear();
-
-		hidden->link(*input);
-		output->link(*hidden);
-
 		// Restore synapsis
 		for (unsigned int i = 0; i < input->size(); i++) {
 			int nout;
 
-			if (in.read((char*) &nout, sizeof(int)) <= 0 )
+			if (!in.read((char*) &nout, sizeof(int)))
 				throw NetworkFileNotFoundException();
 			
 			for (int j = 0; j < nout; j++) {
 				struct synrecord r;
 
-				if (in.read((char*) &r, sizeof(struct synrecord)) <= 0)
+				if (!in.read((char*) &r, sizeof(struct synrecord)))
 					throw NetworkFileNotFoundException();
 				
 				(*input)[i].synOut(j).setWeight(r.w);
@@ -560,13 +1096,13 @@ namespace neuralpp {
 		for (unsigned int i = 0; i < output->size(); i++) {
 			int nin;
 
-			if (in.read((char*) &nin, sizeof(int)) <= 0)
+			if (!in.read((char*) &nin, sizeof(int)))
 				throw NetworkFileNotFoundException();
 
 			for (int j = 0; j < nin; j++) {
 				struct synrecord r;
 				
-				if (in.read((char*) &r, sizeof(struct synrecord)) <= 0)
+				if (!in.read((char*) &r, sizeof(struct synrecord)))
 					throw NetworkFileNotFoundException();
 
 				(*output)[i].synIn(j).setWeight(r.w);
@@ -577,13 +1113,13 @@ namespace neuralpp {
 		for (unsigned int i = 0; i < hidden->size(); i++) {
 			int nin;
 			
-			if (in.read((char*) &nin, sizeof(int)) <= 0)
+			if (!in.read((char*) &nin, sizeof(int)))
 				throw NetworkFileNotFoundException();
 
 			for (int j = 0; j < nin; j++) {
 				struct synrecord r;
 				
-				if (in.read((char*) &r, sizeof(struct synrecord)) <= 0)
+				if (!in.read((char*) &r, sizeof(struct synrecord)))
 					throw NetworkFileNotFoundException();
 
 				(*hidden)[i].synIn(j).setWeight(r.w);
@@ -594,13 +1130,13 @@ namespace neuralpp {
 		for (unsigned int i = 0; i < hidden->size(); i++) {
 			int nout;
 			
-			if (in.read((char*) &nout, sizeof(int)) <= 0)
+			if (!in.read((char*) &nout, sizeof(int)))
 				throw NetworkFileNotFoundException();
 
 			for (int j = 0; j < nout; j++) {
 				struct synrecord r;
 				
-				if (in.read((char*) &r, sizeof(struct synrecord)) <= 0)
+				if (!in.read((char*) &r, sizeof(struct synrecord)))
 					throw NetworkFileNotFoundException();
 
 				(*hidden)[i].synOut(j).setWeight(r.w);
@@ -611,49 +1147,299 @@ namespace neuralpp {
 		in.close();
 	}
 
-	void NeuralNet::train(string xmlsrc, NeuralNet::source src =
-			      file) throw(InvalidXMLException) {
-		CMarkup xml;
+	/**
+	 * Header of a model file
+	 */
+	struct model_header  {
+		char magic[8];
+		uint32_t order;
+		uint32_t version;
+		uint32_t scalar;
+		uint32_t in_size;
+		uint32_t hidden_size;
+		uint32_t out_size;
+		uint32_t epochs;
+		uint32_t checksum;
+		double l_rate;
+		double threshold;
+		uint32_t hid_stride;
+		uint32_t out_stride;
+	};
+
+	static const char MODEL_MAGIC[8] = "NPPMODL";
+	static const uint32_t MODEL_ORDER = 0x01020304;
+	static const uint32_t MODEL_VERSION = 1;
+	static const size_t MODEL_ALIGN = 64;
+
+	static size_t modelPadded (size_t n)  {
+		return (n + MODEL_ALIGN - 1) & ~(MODEL_ALIGN - 1);
+	}
+
+	/**
+	 * Reverse the order of the bytes of a value
+	 */
+	static void byteSwap (void *p, size_t n)  {
+		unsigned char *b = (unsigned char*) p;
 
-		if (src == file)
-			xml.Load(xmlsrc.c_str());
-		else
-			xml.SetDoc(xmlsrc.c_str());
+		for (size_t i = 0; i < n/2; i++)  {
+			unsigned char c = b[i];
+			b[i] = b[n-1-i];
+			b[n-1-i] = c;
+		}
+	}
 
-		if (!xml.IsWellFormed())
-			throw InvalidXMLException("Malformed XML");
+	/**
+	 * Fletcher-like checksum of the 32-bit words of a block whose size is a multiple
+	 * of 4, read in the byte order of the file
+	 */
+	static uint32_t modelChecksum (const char *p, size_t n, bool swap)  {
+		uint32_t a = 1, b = 0;
 
-		if (xml.FindElem("network"))  {
-			while (xml.FindChildElem("training")) {
-				vector<double> input;
-				vector<double> output;
-				xml.IntoElem();
+		for (size_t i = 0; i < n; i += 4)  {
+			uint32_t w;
+			memcpy(&w, p + i, 4);
 
-				while (xml.FindChildElem("input")) {
-					xml.IntoElem();
-					input.push_back(atof(
-								xml.GetData().c_str()));
+			if (swap)
+				byteSwap(&w, 4);
 
-					xml.OutOfElem();
-				}
-				
-				while (xml.FindChildElem("output")) {
-					xml.IntoElem();
-					output.push_back( atof(xml.GetData().c_str()) );
-					xml.OutOfElem();
+			a += w;
+			b += a;
+		}
+
+		return a ^ ((b << 16) | (b >> 16));
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::saveModel (const char *fname) const throw(NetworkFileWriteException)  {
+		if (!input)
+			throw NetworkFileWriteException();
+
+		// A network loaded with loadModel() uses the mapping of its file as its
+		// weights, so the file is written aside and renamed over fname at the end
+		string tmp = tempFile(fname);
+		ofstream out(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+		if (!out)
+			throw NetworkFileWriteException();
+
+		size_t hid_bytes = hidden->size() * hidden->stride * sizeof(T);
+		size_t out_bytes = output->size() * output->stride * sizeof(T);
+		char pad[MODEL_ALIGN];
+		model_header h;
+
+		memset(pad, 0, sizeof(pad));
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, MODEL_MAGIC, sizeof(h.magic));
+		h.order = MODEL_ORDER;
+		h.version = MODEL_VERSION;
+		h.scalar = sizeof(T);
+		h.in_size = input->size();
+		h.hidden_size = hidden->size();
+		h.out_size = output->size();
+		h.epochs = ref_epochs;
+		h.l_rate = l_rate;
+		h.threshold = threshold;
+		h.hid_stride = hidden->stride;
+		h.out_stride = output->stride;
+
+		// Rows are whole multiples of 64 bytes, so the blocks need no padding
+		// for the checksum
+		h.checksum = modelChecksum((const char*) hidden->weights, hid_bytes, false) ^
+			modelChecksum((const char*) output->weights, out_bytes, false);
+
+		out.write((const char*) &h, sizeof(h));
+		out.write((const char*) hidden->weights, hid_bytes);
+		out.write(pad, modelPadded(hid_bytes) - hid_bytes);
+		out.write((const char*) output->weights, out_bytes);
+		out.close();
+
+		if (out.fail())  {
+			std::remove(tmp.c_str());
+			throw NetworkFileWriteException();
+		}
+
+		if (!replaceFile(tmp, fname))
+			throw NetworkFileWriteException();
+	}
+
+	/**
+	 * Copy a weight matrix from a model file, converting its byte order and its
+	 * scalar type if needed
+	 */
+	template <typename T>
+	static void modelWeights (T *dst, size_t dst_stride, const char *src, size_t src_stride,
+			size_t rows, size_t cols, size_t scalar, bool swap)  {
+		for (size_t i = 0; i < rows; i++)  {
+			for (size_t j = 0; j < cols; j++)  {
+				const char *p = src + (i*src_stride + j) * scalar;
+
+				if (scalar == sizeof(float))  {
+					float x;
+					memcpy(&x, p, sizeof(x));
+
+					if (swap)
+						byteSwap(&x, sizeof(x));
+					dst[i*dst_stride + j] = x;
+				} else  {
+					double x;
+					memcpy(&x, p, sizeof(x));
+
+					if (swap)
+						byteSwap(&x, sizeof(x));
+					dst[i*dst_stride + j] = x;
 				}
+			}
+		}
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::loadModel (const string fname) throw(NetworkFileNotFoundException)  {
+		MappedFile *m = new MappedFile;
+
+		if (!m->open(fname.c_str(), true) || m->size() < sizeof(model_header))  {
+			delete m;
+			throw NetworkFileNotFoundException();
+		}
+
+		model_header h;
+		memcpy(&h, m->data(), sizeof(h));
+
+		bool swap = (h.order != MODEL_ORDER);
+		uint32_t *fields[] = { &h.version, &h.scalar, &h.in_size, &h.hidden_size,
+			&h.out_size, &h.epochs, &h.checksum, &h.hid_stride, &h.out_stride };
+
+		if (swap)  {
+			byteSwap(&h.order, sizeof(h.order));
 
-				xml.OutOfElem();
+			for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+				byteSwap(fields[i], sizeof(uint32_t));
 
-				setInput(input);
-				setExpected(output);
-				update();
+			byteSwap(&h.l_rate, sizeof(h.l_rate));
+			byteSwap(&h.threshold, sizeof(h.threshold));
+		}
+
+		bool valid = !memcmp(h.magic, MODEL_MAGIC, sizeof(h.magic)) &&
+			h.order == MODEL_ORDER && h.version == MODEL_VERSION &&
+			(h.scalar == sizeof(float) || h.scalar == sizeof(double)) &&
+			h.in_size && h.hidden_size && h.out_size &&
+			h.hid_stride >= h.in_size && h.out_stride >= h.hidden_size &&
+			!((h.hid_stride * h.scalar) % 4) && !((h.out_stride * h.scalar) % 4);
+
+		size_t hid_bytes = 0, out_bytes = 0;
+
+		if (valid)  {
+			size_t avail = m->size() - sizeof(h);
+			valid = (h.hidden_size <= avail / h.scalar / h.hid_stride);
+
+			if (valid)  {
+				hid_bytes = (size_t) h.hidden_size * h.hid_stride * h.scalar;
+				valid = (modelPadded(hid_bytes) <= avail) &&
+					(h.out_size <= (avail - modelPadded(hid_bytes)) / h.scalar / h.out_stride);
+				out_bytes = (size_t) h.out_size * h.out_stride * h.scalar;
 			}
+		}
+
+		const char *hid_data = m->data() + sizeof(h);
+		const char *out_data = hid_data + modelPadded(hid_bytes);
+
+		if (valid)
+			valid = (h.checksum == (modelChecksum(hid_data, hid_bytes, swap) ^
+						modelChecksum(out_data, out_bytes, swap)));
+
+		if (!valid)  {
+			delete m;
+			throw NetworkFileNotFoundException();
+		}
+
+		build(h.in_size, h.hidden_size, h.out_size, h.l_rate, h.epochs, h.threshold,
+				__actv, false);
+
+		size_t hid_stride = Layer::rowStride(h.in_size);
+		size_t out_stride = Layer::rowStride(h.hidden_size);
+
+		if (!swap && h.scalar == sizeof(T) && h.hid_stride == hid_stride && h.out_stride == out_stride)  {
+			// The weight matrices are used in place
+			hidden->link(*input, (T*) hid_data);
+			output->link(*hidden, (T*) out_data);
+			model = m;
+			return;
+		}
+
+		arena->reserve(Arena::padded(h.hidden_size * hid_stride * sizeof(T)) +
+				Arena::padded(h.out_size * out_stride * sizeof(T)));
+
+		hidden->link(*input, arena->alloc<T>(h.hidden_size * hid_stride));
+		output->link(*hidden, arena->alloc<T>(h.out_size * out_stride));
+
+		modelWeights(hidden->weights, hid_stride, hid_data, h.hid_stride,
+				h.hidden_size, h.in_size, h.scalar, swap);
+		modelWeights(output->weights, out_stride, out_data, h.out_stride,
+				h.out_size, h.hidden_size, h.scalar, swap);
+		delete m;
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::train(string xmlsrc, source src) throw(InvalidXMLException) {
+		// Batches and threads need the whole set, single samples are streamed
+		if (batch_size || train_threads > 1)  {
+			train(BasicTrainingSet<T>(xmlsrc, src));
+			return;
+		}
+
+		ifstream f;
+		istringstream ss;
+		std::istream *in = &ss;
+
+		if (src == file)  {
+			f.open(xmlsrc.c_str(), std::ios::in | std::ios::binary);
+
+			if (!f)
+				throw InvalidXMLException("Cannot open the XML file");
+
+			in = &f;
 		} else
-			throw InvalidXMLException("No 'network' tag specified");
+			ss.str(xmlsrc);
+
+		TrainingXMLReader reader(*in);
+		vector<T> input, output;
+		startTraining();
+
+		while (reader.next(input, output))  {
+			setInput(input);
+			setExpected(output.empty() ? NULL : &output[0], output.size());
+			update();
+
+			if (stop == time_limit)
+				break;
+		}
 	}
 
-	void NeuralNet::initXML(string& xml) {
+	template <typename T>
+	void BasicNeuralNet<T>::train (const BasicTrainingSet<T>& set)  {
+		startTraining();
+
+		if (train_threads > 1)  {
+			updateParallel(set);
+			return;
+		}
+
+		if (batch_size)  {
+			updateBatches(set);
+			return;
+		}
+
+		for (size_t i = 0; i < set.size(); i++)  {
+			setInput(set.input(i), set.inputSize());
+			setExpected(set.target(i), set.outputSize());
+			update();
+
+			if (stop == time_limit)
+				break;
+		}
+	}
+
+	template <typename T>
+	void BasicNeuralNet<T>::initXML(string& xml) {
 		xml.append
 		    ("<?xml version=\"1.0\" encoding=\"iso-8859-1\"?>\n"
 		     "<!DOCTYPE NETWORK SYSTEM \"http://blacklight.gotdns.org/prog/neuralpp/trainer.dtd\">\n"
@@ -661,7 +1447,8 @@ namespace neuralpp {
 		     "<network>\n");
 	}
 
-	string NeuralNet::XMLFromSet (int& id, string set) {
+	template <typename T>
+	string BasicNeuralNet<T>::XMLFromSet (int& id, string set) {
 		string xml;
 		vector<double> in, out;
 		stringstream ss (stringstream::in | stringstream::out);
@@ -709,22 +1496,31 @@ namespace neuralpp {
 		return xml;
 	}
 
-	void NeuralNet::closeXML(string & xml) {
+	template <typename T>
+	void BasicNeuralNet<T>::closeXML(string & xml) {
 		xml.append("</network>\n\n");
 	}
 
 	vector<double> neuralutils::split(char delim, string str) {
-		char tmp[1024];
 		vector <double> v;
-		memset(tmp, 0x0, sizeof(tmp));
+		const char *p = str.c_str();
+		const char *end = p + str.length();
+
+		for (;;) {
+			const char *next = (const char*) memchr(p, delim, end - p);
+			char *e;
 
-		for (unsigned int i = 0, j = 0; i <= str.length(); i++) {
-			if (str[i] == delim || i == str.length()) {
-				v.push_back(atof(tmp));
-				memset(tmp, 0x0, sizeof(tmp));
-				j = 0;
-			} else
-				tmp[j++] = str[i];
+			if (!next)
+				next = end;
+
+			// The number is parsed in place, unless strtod() runs past the field
+			double x = strtod(p, &e);
+			v.push_back((e <= next) ? x : atof(string(p, next).c_str()));
+
+			if (next == end)
+				break;
+
+			p = next + 1;
 		}
 
 		return v;
@@ -759,5 +1555,8 @@ namespace neuralpp {
 				str[i] = (str[i] - 'a') + 'A';
 		}
 	}
+
+	template class BasicNeuralNet<double>;
+	template class BasicNeuralNet<float>;
 }
 
@@ -12,86 +12,72 @@
  **************************************************************************************************/
 
 #include "neural++.hpp"
-
-using std::vector;
+#include "kernels.hpp"
 
 namespace neuralpp {
-	Neuron::Neuron(double (*a) (double), double th) {
-		actv_f = a;
-		threshold = th;
-	}
-	
-	Neuron::Neuron(vector < Synapsis > i, vector < Synapsis > o,
-			 double (*a) (double), double th) {
-
-		in.assign(i.begin(), i.end());
-		out.assign(o.begin(), o.end());
-		actv_f = a;
-		threshold = th;
-	}
-
-	Synapsis & Neuron::synIn(size_t i) {
-		return in[i];
-	}
-
-	Synapsis & Neuron::synOut(size_t i) {
-		return out[i];
-	}
-
-	void Neuron::push_in(Synapsis s)  {
-		in.push_back(s);
+	template <typename T>
+	BasicNeuron<T>::BasicNeuron(Layer * l, size_t i) {
+		layer = l;
+		idx = i;
 	}
 
-	void Neuron::push_out(Synapsis s)  {
-		out.push_back(s);
+	template <typename T>
+	BasicSynapsis<T> BasicNeuron<T>::synIn(size_t i) {
+		return Synapsis(layer, idx * layer->stride + i,
+				&(*layer->prev)[i], this);
 	}
 
-	void Neuron::setProp(double val) {
-		prop_val = val;
+	template <typename T>
+	BasicSynapsis<T> BasicNeuron<T>::synOut(size_t i) {
+		Layer *next = layer->next;
+		return Synapsis(next, i * next->stride + idx,
+				this, &(*next)[i]);
 	}
 
-	void Neuron::setActv(double val) {
-		actv_val = val;
+	template <typename T>
+	void BasicNeuron<T>::setProp(T val) {
+		layer->prop[idx] = val;
 	}
 
-	void Neuron::setSynIn (size_t n)  {
-		in = vector<Synapsis>(n);
+	template <typename T>
+	void BasicNeuron<T>::setActv(T val) {
+		layer->actv[idx] = val;
 	}
 
-	void Neuron::setSynOut (size_t n)  {
-		out = vector<Synapsis>(n);
+	template <typename T>
+	size_t BasicNeuron<T>::nIn() {
+		return (layer->prev) ? layer->prev->size() : 0;
 	}
 
-	size_t Neuron::nIn() {
-		return in.size();
+	template <typename T>
+	size_t BasicNeuron<T>::nOut() {
+		return (layer->next) ? layer->next->size() : 0;
 	}
 
-	size_t Neuron::nOut() {
-		return out.size();
+	template <typename T>
+	T BasicNeuron<T>::getProp() {
+		return layer->prop[idx];
 	}
 
-	double Neuron::getProp() {
-		return prop_val;
+	template <typename T>
+	T BasicNeuron<T>::getActv() {
+		return layer->actv[idx];
 	}
 
-	double Neuron::getActv() {
-		return actv_val;
-	}
-
-	void Neuron::propagate() {
-		double aux = 0.0;
+	template <typename T>
+	void BasicNeuron<T>::propagate() {
+		T aux = 0;
 
-		for (size_t i = 0; i < nIn(); i++)
-			aux += (in[i].getWeight() * in[i].getIn()->actv_val);
+		if (layer->prev)
+			aux = kernels::dot(layer->weights + idx * layer->stride,
+					layer->prev->actv, nIn());
 
-		aux -= threshold;
+		aux -= layer->threshold;
 		setProp(aux);
-		setActv( actv_f(aux) );
+		setActv( layer->actv_f(aux) );
 	}
 
-	void Neuron::synClear()  {
-		in.clear();
-		out.clear();
-	}
+	template class BasicNeuron<double>;
+	template class BasicNeuron<float>;
 }
 
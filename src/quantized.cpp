@@ -0,0 +1,229 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "neural++.hpp"
+#include "kernels.hpp"
+
+using std::vector;
+
+namespace neuralpp  {
+	/**
+	 * Alignment (in bytes) of the quantized weights, which also pads their rows
+	 * to a multiple of the width of the integer SIMD kernels
+	 */
+	static const size_t ALIGNMENT = 64;
+
+	template <typename T>
+	static T* newBuffer (size_t n)  {
+		void *p = NULL;
+
+		if (!n)
+			return NULL;
+
+		if (posix_memalign(&p, ALIGNMENT, n * sizeof(T)))
+			throw std::bad_alloc();
+
+		memset(p, 0x0, n * sizeof(T));
+		return (T*) p;
+	}
+
+	/**
+	 * Round x/scale to the nearest integer in [-127,127]
+	 */
+	static signed char toInt8 (double x, double scale)  {
+		if (scale == 0.0)
+			return 0;
+
+		double q = floor(x / scale + 0.5);
+
+		if (q > 127.0)
+			q = 127.0;
+		else if (q < -127.0)
+			q = -127.0;
+
+		return (signed char) q;
+	}
+
+	template <typename T>
+	void QuantizedNeuralNet::quantize (qlayer& q, const BasicLayer<T>& l)  {
+		size_t n = l.prev->size();
+
+		q.size = l.size();
+		q.stride = ((n + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+		q.weights = newBuffer<signed char>(q.size * q.stride);
+		q.scales = newBuffer<double>(q.size);
+		q.threshold = l.threshold;
+		q.actv_f = l.actv_f;
+
+		// Symmetric quantization, one scale per neuron
+		for (size_t i = 0; i < q.size; i++)  {
+			const T *w = l.weights + i*l.stride;
+			double max = 0.0;
+
+			for (size_t j = 0; j < n; j++)
+				if (fabs(w[j]) > max)
+					max = fabs(w[j]);
+
+			q.scales[i] = max / 127.0;
+
+			for (size_t j = 0; j < n; j++)
+				q.weights[i*q.stride + j] = toInt8(w[j], q.scales[i]);
+		}
+	}
+
+	template <typename T>
+	QuantizedNeuralNet::QuantizedNeuralNet (const BasicNeuralNet<T>& net)  {
+		in_size = net.input->size();
+		quantize(hidden, *net.hidden);
+		quantize(output, *net.output);
+
+		size_t stride = (hidden.stride > output.stride) ? hidden.stride : output.stride;
+		size_t rows = (hidden.size > output.size) ? hidden.size : output.size;
+
+		qin = newBuffer<signed char>(stride);
+		acc = newBuffer<int>(rows);
+
+		input.resize(in_size);
+		hactv.resize(hidden.size);
+		oactv.resize(output.size);
+	}
+
+	QuantizedNeuralNet::~QuantizedNeuralNet()  {
+		free(hidden.weights);
+		free(hidden.scales);
+		free(output.weights);
+		free(output.scales);
+		free(qin);
+		free(acc);
+	}
+
+	void QuantizedNeuralNet::forward (const qlayer& l, const double *in, size_t n, double *out)  {
+		double max = 0.0;
+
+		// The input values are quantized with a single scale for the whole
+		// sample, so that each product only needs to be rescaled once
+		for (size_t j = 0; j < n; j++)
+			if (fabs(in[j]) > max)
+				max = fabs(in[j]);
+
+		double scale = max / 127.0;
+
+		for (size_t j = 0; j < n; j++)
+			qin[j] = toInt8(in[j], scale);
+
+		// The padding columns of the weights are zero, so whatever is left in
+		// the buffer after the first n values doesn't count
+		kernels::gemv(l.weights, l.size, l.stride, l.stride, qin, acc);
+
+		for (size_t i = 0; i < l.size; i++)
+			out[i] = l.actv_f(acc[i] * l.scales[i] * scale - l.threshold);
+	}
+
+	void QuantizedNeuralNet::setInput (const vector<double>& v)  {
+		setInput((v.empty()) ? NULL : &v[0], v.size());
+	}
+
+	void QuantizedNeuralNet::setInput (const double *v, size_t n)  {
+		for (size_t i = 0; i < in_size; i++)
+			input[i] = (i < n) ? v[i] : 0.0;
+	}
+
+	void QuantizedNeuralNet::propagate()  {
+		forward(hidden, &input[0], in_size, &hactv[0]);
+		forward(output, &hactv[0], hidden.size, &oactv[0]);
+	}
+
+	double QuantizedNeuralNet::getOutput() const  {
+		return oactv[0];
+	}
+
+	vector<double> QuantizedNeuralNet::getOutputs() const  {
+		return oactv;
+	}
+
+	size_t QuantizedNeuralNet::getOutputs (double *out, size_t n) const  {
+		if (n > output.size)
+			n = output.size;
+
+		for (size_t i = 0; i < n; i++)
+			out[i] = oactv[i];
+		return n;
+	}
+
+	void QuantizedNeuralNet::propagateBatch (const double *in, size_t n, double *out)  {
+		vector<double> hid(hidden.size);
+
+		for (size_t s = 0; s < n; s++)  {
+			forward(hidden, in + s*in_size, in_size, &hid[0]);
+			forward(output, &hid[0], hidden.size, out + s*output.size);
+		}
+	}
+
+	size_t QuantizedNeuralNet::memory() const  {
+		return (hidden.size * hidden.stride + output.size * output.stride) * sizeof(signed char) +
+			(hidden.size + output.size) * sizeof(double);
+	}
+
+	template <typename T>
+	quantreport QuantizedNeuralNet::compare (BasicNeuralNet<T>& net, const vector< vector<double> >& inputs)  {
+		size_t n = inputs.size(),
+			  out_size = output.size;
+
+		vector<T> in(n * in_size);
+		vector<T> ref(n * out_size);
+		vector<double> x(n * in_size);
+		vector<double> qout(n * out_size);
+		quantreport report;
+
+		for (size_t s = 0; s < n; s++)
+			for (size_t j = 0; j < in_size && j < inputs[s].size(); j++)
+				in[s*in_size + j] = x[s*in_size + j] = inputs[s][j];
+
+		if (n)  {
+			net.propagateBatch(&in[0], n, &ref[0]);
+			propagateBatch(&x[0], n, &qout[0]);
+		}
+
+		report.samples = n;
+		report.max_error = 0.0;
+		report.mean_error = 0.0;
+
+		for (size_t i = 0; i < n * out_size; i++)  {
+			double err = fabs(qout[i] - ref[i]);
+
+			if (err > report.max_error)
+				report.max_error = err;
+			report.mean_error += err;
+		}
+
+		if (n)
+			report.mean_error /= n * out_size;
+
+		report.memory = memory();
+		report.ref_memory = (net.hidden->size() * net.hidden->stride +
+				net.output->size() * net.output->stride) * sizeof(T);
+		return report;
+	}
+
+	template QuantizedNeuralNet::QuantizedNeuralNet (const BasicNeuralNet<double>& net);
+	template QuantizedNeuralNet::QuantizedNeuralNet (const BasicNeuralNet<float>& net);
+	template quantreport QuantizedNeuralNet::compare (BasicNeuralNet<double>& net,
+			const vector< vector<double> >& inputs);
+	template quantreport QuantizedNeuralNet::compare (BasicNeuralNet<float>& net,
+			const vector< vector<double> >& inputs);
+}
+
@@ -0,0 +1,75 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include <ctime>
+#include <pthread.h>
+#include "neural++.hpp"
+
+namespace neuralpp  {
+	static inline uint32_t rotl (uint32_t x, int k)  {
+		return (x << k) | (x >> (32 - k));
+	}
+
+	/**
+	 * Step of a splitmix-like sequence, used to spread a 32-bit seed over the
+	 * whole state of the generator
+	 */
+	static uint32_t splitmix (uint32_t& x)  {
+		uint32_t z = (x += 0x9e3779b9u);
+		z = (z ^ (z >> 16)) * 0x85ebca6bu;
+		z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+		return z ^ (z >> 16);
+	}
+
+	Random::Random (uint32_t seed)  {
+		this->seed(seed);
+	}
+
+	void Random::seed (uint32_t seed)  {
+		for (int i = 0; i < 4; i++)
+			s[i] = splitmix(seed);
+	}
+
+	uint32_t Random::next()  {
+		uint32_t result = rotl(s[1] * 5, 7) * 9;
+		uint32_t t = s[1] << 9;
+
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 11);
+
+		return result;
+	}
+
+	double Random::uniform()  {
+		uint32_t hi = next() >> 5, lo = next() >> 6;
+		return (hi * 67108864.0 + lo) / 9007199254740992.0;
+	}
+
+	uint32_t Random::timeSeed()  {
+		static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+		static uint32_t counter = 0;
+
+		// The counter tells apart the seeds taken within the same clock tick
+		pthread_mutex_lock(&lock);
+		uint32_t c = ++counter;
+		pthread_mutex_unlock(&lock);
+
+		uint32_t seed = (uint32_t) time(NULL) ^ (c * 0x9e3779b9u);
+		return (seed) ? seed : 1;
+	}
+}
+
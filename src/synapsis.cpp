@@ -11,68 +11,63 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
  **************************************************************************************************/
 
-#include <cstdlib>
 #include "neural++.hpp"
 
 namespace neuralpp {
-	Synapsis::Synapsis(Neuron * i, Neuron * o, double (*a) (double)) {
-		srand((unsigned) time(NULL));
-
-		delta = 0;
-		prev_delta = 0;
-		weight = RAND;
-		in = i;
-		out = o;
-
-		actv_f = a;
-	}
-
-	Synapsis::Synapsis(Neuron * i, Neuron * o,
-			   double w, double (*a) (double)) {
-		
-		delta = 0;
-		prev_delta = 0;
-		weight = w;
+	template <typename T>
+	BasicSynapsis<T>::BasicSynapsis(Layer * l, size_t p, Neuron * i, Neuron * o) {
+		layer = l;
+		pos = p;
 		in = i;
 		out = o;
-
-		actv_f = a;
 	}
 
-	Neuron *Synapsis::getIn() const  {
+	template <typename T>
+	BasicNeuron<T> *BasicSynapsis<T>::getIn() const  {
 		return in;
 	}
 
-	Neuron *Synapsis::getOut() const  {
+	template <typename T>
+	BasicNeuron<T> *BasicSynapsis<T>::getOut() const  {
 		return out;
 	}
 
-	double Synapsis::getWeight() const  {
-		return weight;
+	template <typename T>
+	T BasicSynapsis<T>::getWeight() const  {
+		return layer->weights[pos];
 	}
 
-	double Synapsis::getDelta() const  {
-		return delta;
+	template <typename T>
+	T BasicSynapsis<T>::getDelta() const  {
+		return (layer->delta) ? layer->delta[pos] : 0;
 	}
 
-	double Synapsis::getPrevDelta() const  {
-		return prev_delta;
+	template <typename T>
+	T BasicSynapsis<T>::getPrevDelta() const  {
+		return (layer->prev_delta) ? layer->prev_delta[pos] : 0;
 	}
 
-	void Synapsis::setWeight(double w) throw(InvalidSynapticalWeightException)  {
-		if (weight > 1.0)
+	template <typename T>
+	void BasicSynapsis<T>::setWeight(T w) throw(InvalidSynapticalWeightException)  {
+		if (layer->weights[pos] > 1.0)
 			throw InvalidSynapticalWeightException();
 
-		weight = w;
+		layer->weights[pos] = w;
 	}
 
-	void Synapsis::setDelta(double d) throw(InvalidSynapticalWeightException)  {
-		prev_delta = delta;
-		delta = d;
+	template <typename T>
+	void BasicSynapsis<T>::setDelta(T d) throw(InvalidSynapticalWeightException)  {
+		layer->initDeltas();
+		layer->prev_delta[pos] = layer->delta[pos];
+		layer->delta[pos] = d;
 	}
 
-	double Synapsis::momentum(int N, int x) const  {
+	template <typename T>
+	double BasicSynapsis<T>::momentum(int N, int x)  {
 		return (BETA0 * N) / (20 * x + N);
 	}
+
+	template class BasicSynapsis<double>;
+	template class BasicSynapsis<float>;
 }
 
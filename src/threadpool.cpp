@@ -0,0 +1,132 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include "threadpool.hpp"
+
+namespace neuralpp  {
+	struct workerarg  {
+		ThreadPool *pool;
+		size_t part;
+	};
+
+	ThreadPool::ThreadPool (size_t n)  {
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&start, NULL);
+		pthread_cond_init(&done, NULL);
+
+		cur_job = NULL;
+		cur_arg = NULL;
+		generation = 0;
+		pending = 0;
+		quit = false;
+
+		for (size_t i = 1; i < n; i++)  {
+			pthread_t t;
+			workerarg *arg = new workerarg;
+			arg->pool = this;
+			arg->part = i;
+
+			if (pthread_create(&t, NULL, worker, arg))  {
+				delete arg;
+				break;
+			}
+
+			workers.push_back(t);
+		}
+	}
+
+	ThreadPool::~ThreadPool()  {
+		pthread_mutex_lock(&lock);
+		quit = true;
+		pthread_cond_broadcast(&start);
+		pthread_mutex_unlock(&lock);
+
+		for (size_t i = 0; i < workers.size(); i++)
+			pthread_join(workers[i], NULL);
+
+		pthread_cond_destroy(&done);
+		pthread_cond_destroy(&start);
+		pthread_mutex_destroy(&lock);
+	}
+
+	size_t ThreadPool::size() const  {
+		return workers.size() + 1;
+	}
+
+	void ThreadPool::run (job f, void *arg)  {
+		size_t parts = size();
+
+		if (parts == 1)  {
+			f(arg, 0, 1);
+			return;
+		}
+
+		pthread_mutex_lock(&lock);
+		cur_job = f;
+		cur_arg = arg;
+		pending = workers.size();
+		generation++;
+		pthread_cond_broadcast(&start);
+		pthread_mutex_unlock(&lock);
+
+		f(arg, 0, parts);
+
+		pthread_mutex_lock(&lock);
+
+		while (pending)
+			pthread_cond_wait(&done, &lock);
+
+		pthread_mutex_unlock(&lock);
+	}
+
+	void* ThreadPool::worker (void *p)  {
+		workerarg *arg = (workerarg*) p;
+		ThreadPool *pool = arg->pool;
+		size_t part = arg->part;
+		unsigned long seen = 0;
+
+		delete arg;
+
+		while (true)  {
+			job f;
+			void *a;
+
+			pthread_mutex_lock(&pool->lock);
+
+			while (!pool->quit && pool->generation == seen)
+				pthread_cond_wait(&pool->start, &pool->lock);
+
+			if (pool->quit)  {
+				pthread_mutex_unlock(&pool->lock);
+				break;
+			}
+
+			seen = pool->generation;
+			f = pool->cur_job;
+			a = pool->cur_arg;
+			pthread_mutex_unlock(&pool->lock);
+
+			f(a, part, pool->size());
+
+			pthread_mutex_lock(&pool->lock);
+
+			if (--pool->pending == 0)
+				pthread_cond_signal(&pool->done);
+
+			pthread_mutex_unlock(&pool->lock);
+		}
+
+		return NULL;
+	}
+}
+
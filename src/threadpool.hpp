@@ -0,0 +1,77 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#ifndef __NEURALPP_THREADPOOL
+#define __NEURALPP_THREADPOOL
+
+#include <cstddef>
+#include <vector>
+#include <pthread.h>
+
+namespace neuralpp  {
+	/**
+	 * @class ThreadPool
+	 * @brief Persistent pool of worker threads, used to split the work of wide layers across
+	 *  the cores of the machine. The threads are created once and sleep between two jobs
+	 */
+	class ThreadPool  {
+	public:
+		/**
+		 * @brief Job to be run by the pool
+		 * @param arg Argument passed to run()
+		 * @param part Index of the part of the job to be done (0 <= part < parts)
+		 * @param parts Number of parts the job is split into
+		 */
+		typedef void (*job) (void *arg, size_t part, size_t parts);
+
+		/**
+		 * @brief Constructor
+		 * @param n Number of threads (including the one calling run())
+		 */
+		ThreadPool (size_t n);
+		~ThreadPool();
+
+		/**
+		 * @return Number of threads of the pool, including the calling one
+		 */
+		size_t size() const;
+
+		/**
+		 * @brief Run a job splitting it in size() parts, one per thread, and wait for
+		 *  all of them to complete. The calling thread does part 0
+		 * @param f Job to be run
+		 * @param arg Argument for the job
+		 */
+		void run (job f, void *arg);
+
+	private:
+		std::vector<pthread_t> workers;
+		pthread_mutex_t lock;
+		pthread_cond_t start;
+		pthread_cond_t done;
+
+		job cur_job;
+		void *cur_arg;
+		unsigned long generation;
+		size_t pending;
+		bool quit;
+
+		ThreadPool (const ThreadPool&);
+		ThreadPool& operator= (const ThreadPool&);
+
+		static void* worker (void *arg);
+	};
+}
+
+#endif
+
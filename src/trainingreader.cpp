@@ -0,0 +1,234 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include "neural++.hpp"
+#include "xmlscan.hpp"
+
+using std::vector;
+using std::string;
+using std::istream;
+using std::ifstream;
+
+namespace neuralpp  {
+	/**
+	 * Initial size of the read buffer
+	 */
+	static const size_t CHUNK = 64 * 1024;
+
+	TrainingXMLReader::TrainingXMLReader (const string fname) throw(InvalidXMLException)  {
+		ifstream *f = new ifstream(fname.c_str(), std::ios::in | std::ios::binary);
+
+		if (!*f)  {
+			delete f;
+			throw InvalidXMLException("Cannot open the XML file");
+		}
+
+		owned = in = f;
+		init();
+	}
+
+	TrainingXMLReader::TrainingXMLReader (istream& stream)  {
+		in = &stream;
+		owned = NULL;
+		init();
+	}
+
+	TrainingXMLReader::~TrainingXMLReader()  {
+		delete owned;
+		free(buf);
+	}
+
+	void TrainingXMLReader::init()  {
+		cap = CHUNK;
+		buf = (char*) malloc(cap);
+
+		if (!buf)  {
+			delete owned;
+			throw std::bad_alloc();
+		}
+
+		pos = end = 0;
+		started = finished = false;
+		count = 0;
+	}
+
+	size_t TrainingXMLReader::samples() const  {
+		return count;
+	}
+
+	bool TrainingXMLReader::fill()  {
+		if (pos)  {
+			memmove(buf, buf + pos, end - pos);
+			end -= pos;
+			pos = 0;
+		}
+
+		// The buffer only grows when a single tag doesn't fit in it
+		if (end == cap)  {
+			char *p = (char*) realloc(buf, cap * 2);
+
+			if (!p)
+				throw std::bad_alloc();
+
+			buf = p;
+			cap *= 2;
+		}
+
+		in->read(buf + end, cap - end);
+		end += in->gcount();
+		return in->gcount() > 0;
+	}
+
+	bool TrainingXMLReader::nextTag (string *text, string& name, tagtype& type)
+		throw(InvalidXMLException)  {
+		if (text)
+			text->clear();
+
+		for (;;)  {
+			const char *lt = (const char*) memchr(buf + pos, '<', end - pos);
+
+			if (!lt)  {
+				if (text)
+					text->append(buf + pos, end - pos);
+
+				pos = end;
+
+				if (!fill())
+					return false;
+				continue;
+			}
+
+			if (text)
+				text->append(buf + pos, lt - (buf + pos));
+			pos = lt - buf;
+
+			size_t len;
+
+			while (!(len = xmlscan::markupEnd(buf + pos, end - pos)))
+				if (!fill())
+					throw InvalidXMLException("Unterminated tag");
+
+			const char *p = buf + pos;
+			pos += len;
+
+			if (p[1] == '!' || p[1] == '?')  {
+				// The content of a CDATA section is character data, anything
+				// else (comments, declarations, instructions) is skipped
+				if (text && len >= 12 && !strncmp(p, "<![CDATA[", 9))
+					text->append(p + 9, len - 12);
+				continue;
+			}
+
+			const char *s = p + 1;
+			type = opening;
+
+			if (*s == '/')  {
+				type = closing;
+				s++;
+			} else if (p[len-2] == '/')
+				type = single;
+
+			const char *e = s;
+
+			while (e < p + len - 1 && !strchr(" \t\r\n/>", *e))
+				e++;
+
+			name.assign(s, e - s);
+			return true;
+		}
+	}
+
+	template <typename T>
+	bool TrainingXMLReader::read (vector<T>& input, vector<T>& output) throw(InvalidXMLException)  {
+		string text, name, value;
+		tagtype type, vtype;
+
+		input.clear();
+		output.clear();
+
+		if (finished)
+			return false;
+
+		while (nextTag(NULL, name, type))  {
+			if (!started)  {
+				if (type == closing || name != "network")
+					throw InvalidXMLException("No 'network' tag specified");
+
+				started = true;
+				finished = (type == single);
+
+				if (finished)
+					return false;
+				continue;
+			}
+
+			if (name == "network" && type == closing)  {
+				finished = true;
+				return false;
+			}
+
+			if (name != "training" || type == closing)
+				continue;
+
+			bool done = (type == single);
+
+			while (!done)  {
+				if (!nextTag(NULL, name, type))
+					throw InvalidXMLException("Malformed XML");
+
+				if (name == "training" && type == closing)  {
+					done = true;
+					continue;
+				}
+
+				if ((name != "input" && name != "output") || type == closing)
+					continue;
+
+				vector<T>& v = (name == "input") ? input : output;
+
+				if (type == single)  {
+					v.push_back(0.0);
+					continue;
+				}
+
+				if (!nextTag(&text, value, vtype) || vtype != closing || value != name)
+					throw InvalidXMLException("Malformed XML");
+
+				v.push_back(strtod(text.c_str(), NULL));
+			}
+
+			count++;
+			return true;
+		}
+
+		if (!started)
+			throw InvalidXMLException("No 'network' tag specified");
+
+		throw InvalidXMLException("Malformed XML");
+	}
+
+	bool TrainingXMLReader::next (vector<double>& input, vector<double>& output)
+		throw(InvalidXMLException)  {
+		return read(input, output);
+	}
+
+	bool TrainingXMLReader::next (vector<float>& input, vector<float>& output)
+		throw(InvalidXMLException)  {
+		return read(input, output);
+	}
+}
+
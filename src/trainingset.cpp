@@ -0,0 +1,565 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "neural++.hpp"
+#include "mappedfile.hpp"
+
+using std::vector;
+using std::string;
+using std::istringstream;
+using std::ifstream;
+using std::ofstream;
+using std::fstream;
+
+namespace neuralpp  {
+	/**
+	 * Header of a binary dataset file
+	 */
+	struct dataset_header  {
+		char magic[8];
+		uint32_t order;
+		uint32_t version;
+		uint32_t scalar;
+		uint32_t in_size;
+		uint32_t out_size;
+		uint32_t samples_lo;
+		uint32_t samples_hi;
+		uint32_t reserved[7];
+	};
+
+	static const char DATASET_MAGIC[8] = "NPPDATA";
+	static const uint32_t DATASET_ORDER = 0x01020304;
+	static const uint32_t DATASET_VERSION = 1;
+	static const size_t DATASET_ALIGN = 64;
+
+	static size_t datasetPadded (size_t n)  {
+		return (n + DATASET_ALIGN - 1) & ~(DATASET_ALIGN - 1);
+	}
+
+	static void datasetHeader (dataset_header& h, size_t scalar, size_t in, size_t out, size_t n)  {
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, DATASET_MAGIC, sizeof(h.magic));
+		h.order = DATASET_ORDER;
+		h.version = DATASET_VERSION;
+		h.scalar = scalar;
+		h.in_size = in;
+		h.out_size = out;
+		h.samples_lo = n & 0xffffffff;
+		h.samples_hi = (sizeof(size_t) > 4) ? (n >> 16 >> 16) : 0;
+	}
+
+	template <typename T>
+	BasicTrainingSet<T>::BasicTrainingSet (size_t in, size_t out)  {
+		in_size = in;
+		out_size = out;
+		n_samples = 0;
+		map = NULL;
+		sync();
+	}
+
+	template <typename T>
+	BasicTrainingSet<T>::BasicTrainingSet (const string xmlsrc,
+			typename BasicNeuralNet<T>::source src) throw(InvalidXMLException)  {
+		in_size = 0;
+		out_size = 0;
+		n_samples = 0;
+		map = NULL;
+		sync();
+
+		vector<T> input, output;
+
+		if (src == BasicNeuralNet<T>::file)  {
+			TrainingXMLReader reader(xmlsrc);
+
+			while (reader.next(input, output))
+				add(input, output);
+		} else {
+			istringstream ss(xmlsrc);
+			TrainingXMLReader reader(ss);
+
+			while (reader.next(input, output))
+				add(input, output);
+		}
+	}
+
+	template <typename T>
+	BasicTrainingSet<T>::BasicTrainingSet (const BasicTrainingSet<T>& set)  {
+		map = NULL;
+		*this = set;
+	}
+
+	template <typename T>
+	BasicTrainingSet<T>::~BasicTrainingSet()  {
+		delete map;
+	}
+
+	template <typename T>
+	BasicTrainingSet<T>& BasicTrainingSet<T>::operator= (const BasicTrainingSet<T>& set)  {
+		if (this == &set)
+			return *this;
+
+		in_size = set.in_size;
+		out_size = set.out_size;
+		n_samples = set.n_samples;
+
+		// Copy from the matrices rather than from the vectors, which are empty
+		// for a mapped set
+		inputs.assign(set.in_data, set.in_data + n_samples * in_size);
+		targets.assign(set.out_data, set.out_data + n_samples * out_size);
+
+		delete map;
+		map = NULL;
+		sync();
+		return *this;
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::sync()  {
+		in_data = (inputs.empty()) ? NULL : &inputs[0];
+		out_data = (targets.empty()) ? NULL : &targets[0];
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::detach()  {
+		if (!map)
+			return;
+
+		inputs.assign(in_data, in_data + n_samples * in_size);
+		targets.assign(out_data, out_data + n_samples * out_size);
+
+		delete map;
+		map = NULL;
+		sync();
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::reshape (size_t in, size_t out)  {
+		size_t n = size();
+		vector<T> new_inputs(n * in), new_targets(n * out);
+
+		for (size_t i = 0; i < n; i++)  {
+			for (size_t j = 0; j < in_size; j++)
+				new_inputs[i*in + j] = inputs[i*in_size + j];
+
+			for (size_t j = 0; j < out_size; j++)
+				new_targets[i*out + j] = targets[i*out_size + j];
+		}
+
+		inputs.swap(new_inputs);
+		targets.swap(new_targets);
+		in_size = in;
+		out_size = out;
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::add (const T *in, const T *out)  {
+		detach();
+		inputs.insert(inputs.end(), in, in + in_size);
+		targets.insert(targets.end(), out, out + out_size);
+		n_samples++;
+		sync();
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::add (const vector<T>& in, const vector<T>& out)  {
+		detach();
+
+		if (in.size() > in_size || out.size() > out_size)
+			reshape((in.size() > in_size) ? in.size() : in_size,
+					(out.size() > out_size) ? out.size() : out_size);
+
+		inputs.insert(inputs.end(), in.begin(), in.end());
+		inputs.resize(inputs.size() + in_size - in.size(), 0.0);
+		targets.insert(targets.end(), out.begin(), out.end());
+		targets.resize(targets.size() + out_size - out.size(), 0.0);
+		n_samples++;
+		sync();
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::parseCSV (const char *p, const char *end, const csvformat& format,
+			size_t& line, size_t& skip) throw(InvalidCSVException)  {
+		const char delim = format.delim;
+		size_t last = format.in_first + format.in_count;
+
+		if (format.out_first + format.out_count > last)
+			last = format.out_first + format.out_count;
+
+		for (const char *eol; p < end; p = eol + 1)  {
+			eol = (const char*) memchr(p, '\n', end - p);
+
+			if (!eol)
+				eol = end;
+
+			line++;
+
+			if (skip)  {
+				skip--;
+				continue;
+			}
+
+			const char *le = (eol > p && eol[-1] == '\r') ? eol - 1 : eol;
+			const char *q = p;
+
+			while (q < le && (*q == ' ' || *q == '\t') && *q != delim)
+				q++;
+
+			if (q == le)
+				continue;
+
+			// The values are parsed straight into the rows of the matrices
+			size_t ib = inputs.size(), ob = targets.size();
+			inputs.resize(ib + in_size, 0.0);
+			targets.resize(ob + out_size, 0.0);
+
+			const char *field = p;
+			const char *err = NULL;
+
+			for (size_t col = 0; col < last && !err; col++)  {
+				if (field > le)  {
+					err = "Too few columns";
+					break;
+				}
+
+				const char *next = (const char*) memchr(field, delim, le - field);
+
+				if (!next)
+					next = le;
+
+				T *dst = NULL;
+
+				if (col - format.in_first < format.in_count)
+					dst = &inputs[ib + col - format.in_first];
+				else if (col - format.out_first < format.out_count)
+					dst = &targets[ob + col - format.out_first];
+
+				if (dst)  {
+					char *e;
+					double v = strtod(field, &e);
+
+					// strtod() skips leading blanks, so an empty field would make it run
+					// into the next one
+					while (e < next && (*e == ' ' || *e == '\t'))
+						e++;
+
+					if (e == field || e != next)
+						err = "Invalid number";
+
+					*dst = v;
+				}
+
+				field = next + 1;
+			}
+
+			if (err)  {
+				inputs.resize(ib);
+				targets.resize(ob);
+				sync();
+				throw InvalidCSVException(err, line);
+			}
+
+			n_samples++;
+		}
+	}
+
+	template <typename T>
+	size_t BasicTrainingSet<T>::addCSV (const string csv, const csvformat& format,
+			typename BasicNeuralNet<T>::source src) throw(InvalidCSVException)  {
+		size_t before = n_samples, line = 0, skip = format.skip;
+
+		detach();
+
+		if (format.in_count > in_size || format.out_count > out_size)
+			reshape((format.in_count > in_size) ? format.in_count : in_size,
+					(format.out_count > out_size) ? format.out_count : out_size);
+
+		if (src == BasicNeuralNet<T>::str)  {
+			parseCSV(csv.c_str(), csv.c_str() + csv.length(), format, line, skip);
+			sync();
+			return n_samples - before;
+		}
+
+		ifstream in(csv.c_str(), std::ios::in | std::ios::binary);
+
+		if (!in)
+			throw InvalidCSVException("Cannot open the file");
+
+		// Read the file in chunks, parsing the complete lines of each one and keeping
+		// the rest for the next chunk. The buffer only grows for lines longer than it
+		vector<char> buf(64 * 1024 + 1);
+		size_t len = 0;
+
+		for (bool eof = false; !eof || len; )  {
+			if (len == buf.size() - 1)
+				buf.resize(2 * buf.size() - 1);
+
+			if (!eof)  {
+				in.read(&buf[len], buf.size() - 1 - len);
+				eof = (in.gcount() == 0);
+				len += in.gcount();
+			}
+
+			buf[len] = 0;
+			size_t n = len;
+
+			if (!eof)
+				while (n && buf[n-1] != '\n')
+					n--;
+
+			if (!n && !eof)
+				continue;
+
+			parseCSV(&buf[0], &buf[0] + n, format, line, skip);
+			memmove(&buf[0], &buf[0] + n, len - n);
+			len -= n;
+		}
+
+		sync();
+		return n_samples - before;
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::clear()  {
+		delete map;
+		map = NULL;
+		inputs.clear();
+		targets.clear();
+		n_samples = 0;
+		sync();
+	}
+
+	template <typename T>
+	size_t BasicTrainingSet<T>::size() const  {
+		return n_samples;
+	}
+
+	template <typename T>
+	size_t BasicTrainingSet<T>::inputSize() const  {
+		return in_size;
+	}
+
+	template <typename T>
+	size_t BasicTrainingSet<T>::outputSize() const  {
+		return out_size;
+	}
+
+	template <typename T>
+	const T* BasicTrainingSet<T>::input (size_t i) const  {
+		return (in_size) ? in_data + i * in_size : NULL;
+	}
+
+	template <typename T>
+	const T* BasicTrainingSet<T>::target (size_t i) const  {
+		return (out_size) ? out_data + i * out_size : NULL;
+	}
+
+	template <typename T>
+	bool BasicTrainingSet<T>::mapped() const  {
+		return map != NULL;
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::save (const string fname) const throw(DatasetFileWriteException)  {
+		// The set may be mapped from fname itself, so the file is written aside
+		// and renamed over fname only when it's complete
+		string tmp = tempFile(fname);
+		ofstream out(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+		if (!out)
+			throw DatasetFileWriteException();
+
+		dataset_header h;
+		datasetHeader(h, sizeof(T), in_size, out_size, n_samples);
+
+		size_t in_bytes = n_samples * in_size * sizeof(T);
+		size_t out_bytes = n_samples * out_size * sizeof(T);
+		char pad[DATASET_ALIGN];
+		memset(pad, 0, sizeof(pad));
+
+		out.write((const char*) &h, sizeof(h));
+		out.write((const char*) in_data, in_bytes);
+		out.write(pad, datasetPadded(in_bytes) - in_bytes);
+		out.write((const char*) out_data, out_bytes);
+		out.close();
+
+		if (out.fail())  {
+			std::remove(tmp.c_str());
+			throw DatasetFileWriteException();
+		}
+
+		if (!replaceFile(tmp, fname))
+			throw DatasetFileWriteException();
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::load (const string fname) throw(InvalidDatasetException)  {
+		MappedFile *m = new MappedFile;
+
+		if (!m->open(fname.c_str()))  {
+			delete m;
+			throw InvalidDatasetException("Cannot open the file");
+		}
+
+		const char *err = NULL;
+		const dataset_header *h = (const dataset_header*) m->data();
+		size_t n = 0, in_bytes = 0, out_bytes = 0;
+
+		if (m->size() < sizeof(dataset_header) || memcmp(h->magic, DATASET_MAGIC, sizeof(h->magic)))
+			err = "Not a dataset file";
+		else if (h->order != DATASET_ORDER)
+			err = "The file has a different byte order";
+		else if (h->version != DATASET_VERSION)
+			err = "Unsupported format version";
+		else if (h->scalar != sizeof(float) && h->scalar != sizeof(double))
+			err = "Unsupported scalar type";
+		else if (sizeof(size_t) <= 4 && h->samples_hi)
+			err = "The dataset is too large";
+		else  {
+			n = h->samples_lo;
+
+			if (sizeof(size_t) > 4)
+				n |= (size_t) h->samples_hi << 16 << 16;
+
+			size_t row = (h->in_size + h->out_size) * (size_t) h->scalar;
+
+			if (row && n > (m->size() - sizeof(dataset_header)) / row)
+				err = "Truncated file";
+			else  {
+				in_bytes = n * h->in_size * h->scalar;
+				out_bytes = n * h->out_size * h->scalar;
+
+				if (sizeof(dataset_header) + datasetPadded(in_bytes) + out_bytes > m->size())
+					err = "Truncated file";
+			}
+		}
+
+		if (err)  {
+			delete m;
+			throw InvalidDatasetException(err);
+		}
+
+		const char *in_ptr = m->data() + sizeof(dataset_header);
+		const char *out_ptr = in_ptr + datasetPadded(in_bytes);
+
+		delete map;
+		map = NULL;
+		in_size = h->in_size;
+		out_size = h->out_size;
+		n_samples = n;
+
+		if (h->scalar == sizeof(T))  {
+			inputs.clear();
+			targets.clear();
+			in_data = (const T*) in_ptr;
+			out_data = (const T*) out_ptr;
+			map = m;
+			return;
+		}
+
+		// Values of a different type have to be converted
+		if (h->scalar == sizeof(float))  {
+			inputs.assign((const float*) in_ptr, (const float*) in_ptr + n * in_size);
+			targets.assign((const float*) out_ptr, (const float*) out_ptr + n * out_size);
+		} else  {
+			inputs.assign((const double*) in_ptr, (const double*) in_ptr + n * in_size);
+			targets.assign((const double*) out_ptr, (const double*) out_ptr + n * out_size);
+		}
+
+		delete m;
+		sync();
+	}
+
+	template <typename T>
+	void BasicTrainingSet<T>::convert (const string xml, const string fname)
+		throw(InvalidXMLException, DatasetFileWriteException)  {
+		vector<T> input, output;
+		size_t in = 0, out = 0, n = 0;
+
+		{
+			TrainingXMLReader reader(xml);
+
+			for (; reader.next(input, output); n++)  {
+				if (input.size() > in)
+					in = input.size();
+				if (output.size() > out)
+					out = output.size();
+			}
+		}
+
+		dataset_header h;
+		datasetHeader(h, sizeof(T), in, out, n);
+
+		size_t in_bytes = n * in * sizeof(T);
+		size_t out_off = sizeof(h) + datasetPadded(in_bytes);
+		size_t total = out_off + n * out * sizeof(T);
+
+		// Write the header and give the file its final size, then fill the two
+		// matrices through two streams. As in save(), a set may be mapped from
+		// fname, so the file is written aside and then renamed over it
+		string tmp = tempFile(fname);
+
+		{
+			ofstream f(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			f.write((const char*) &h, sizeof(h));
+
+			if (total > sizeof(h))  {
+				f.seekp(total - 1);
+				f.put(0);
+			}
+
+			f.close();
+
+			if (f.fail())  {
+				std::remove(tmp.c_str());
+				throw DatasetFileWriteException();
+			}
+		}
+
+		fstream fin(tmp.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		fstream fout(tmp.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		fin.seekp(sizeof(h));
+		fout.seekp(out_off);
+
+		TrainingXMLReader reader(xml);
+
+		while (reader.next(input, output))  {
+			input.resize(in, 0.0);
+			output.resize(out, 0.0);
+
+			if (in)
+				fin.write((const char*) &input[0], in * sizeof(T));
+			if (out)
+				fout.write((const char*) &output[0], out * sizeof(T));
+		}
+
+		fin.close();
+		fout.close();
+
+		if (fin.fail() || fout.fail() || reader.samples() != n)  {
+			std::remove(tmp.c_str());
+			throw DatasetFileWriteException();
+		}
+
+		if (!replaceFile(tmp, fname))
+			throw DatasetFileWriteException();
+	}
+
+	template class BasicTrainingSet<double>;
+	template class BasicTrainingSet<float>;
+}
+
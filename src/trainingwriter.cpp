@@ -0,0 +1,160 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include <fstream>
+#include "neural++.hpp"
+#include "xmlscan.hpp"
+
+using std::vector;
+using std::string;
+using std::ostream;
+using std::ofstream;
+
+namespace neuralpp  {
+	/**
+	 * Size the buffer reaches before being written to the stream
+	 */
+	static const size_t FLUSH_SIZE = 64 * 1024;
+
+	TrainingXMLWriter::TrainingXMLWriter (const string fname) throw(DatasetFileWriteException)  {
+		ofstream *f = new ofstream(fname.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+		if (!*f)  {
+			delete f;
+			throw DatasetFileWriteException();
+		}
+
+		owned = out = f;
+		init();
+	}
+
+	TrainingXMLWriter::TrainingXMLWriter (ostream& stream)  {
+		out = &stream;
+		owned = NULL;
+		init();
+	}
+
+	TrainingXMLWriter::~TrainingXMLWriter()  {
+		try  {
+			close();
+		} catch (DatasetFileWriteException& e)  {
+		}
+
+		delete owned;
+	}
+
+	void TrainingXMLWriter::init()  {
+		buf.reserve(FLUSH_SIZE + 4096);
+		id = 0;
+		count = 0;
+		closed = false;
+		NeuralNet::initXML(buf);
+	}
+
+	void TrainingXMLWriter::flush() throw(DatasetFileWriteException)  {
+		out->write(buf.data(), buf.size());
+		buf.clear();
+
+		if (out->fail())
+			throw DatasetFileWriteException();
+	}
+
+	void TrainingXMLWriter::put (const char *tag, double x, bool single)  {
+		buf += "\t\t<";
+		buf += tag;
+		buf += " id=\"";
+		xmlscan::appendUnsigned(buf, id++);
+		buf += "\">";
+		xmlscan::appendReal(buf, x, single);
+		buf += "</";
+		buf += tag;
+		buf += ">\n";
+	}
+
+	template <typename T>
+	void TrainingXMLWriter::write (const T *in, size_t n_in, const T *out, size_t n_out)
+		throw(DatasetFileWriteException)  {
+		if (closed)
+			throw DatasetFileWriteException();
+
+		bool single = (sizeof(T) == sizeof(float));
+
+		buf += "\t<training id=\"";
+		xmlscan::appendUnsigned(buf, id++);
+		buf += "\">\n";
+
+		for (size_t i = 0; i < n_in; i++)
+			put("input", in[i], single);
+
+		for (size_t i = 0; i < n_out; i++)
+			put("output", out[i], single);
+
+		buf += "\t</training>\n\n";
+		count++;
+
+		if (buf.size() >= FLUSH_SIZE)
+			flush();
+	}
+
+	void TrainingXMLWriter::add (const double *in, size_t n_in, const double *out, size_t n_out)
+		throw(DatasetFileWriteException)  {
+		write(in, n_in, out, n_out);
+	}
+
+	void TrainingXMLWriter::add (const float *in, size_t n_in, const float *out, size_t n_out)
+		throw(DatasetFileWriteException)  {
+		write(in, n_in, out, n_out);
+	}
+
+	void TrainingXMLWriter::add (const vector<double>& in, const vector<double>& out)
+		throw(DatasetFileWriteException)  {
+		write((in.empty()) ? NULL : &in[0], in.size(), (out.empty()) ? NULL : &out[0], out.size());
+	}
+
+	void TrainingXMLWriter::add (const vector<float>& in, const vector<float>& out)
+		throw(DatasetFileWriteException)  {
+		write((in.empty()) ? NULL : &in[0], in.size(), (out.empty()) ? NULL : &out[0], out.size());
+	}
+
+	bool TrainingXMLWriter::add (const string set) throw(DatasetFileWriteException)  {
+		size_t delimPos = set.find(';');
+
+		if (delimPos == string::npos)
+			return false;
+
+		add(neuralutils::split(',', set.substr(0, delimPos)),
+				neuralutils::split(',', set.substr(delimPos + 1)));
+		return true;
+	}
+
+	void TrainingXMLWriter::close() throw(DatasetFileWriteException)  {
+		if (closed)
+			return;
+
+		closed = true;
+		NeuralNet::closeXML(buf);
+		flush();
+		out->flush();
+
+		if (owned)
+			((ofstream*) owned)->close();
+
+		if (out->fail())
+			throw DatasetFileWriteException();
+	}
+
+	size_t TrainingXMLWriter::samples() const  {
+		return count;
+	}
+}
+
@@ -0,0 +1,211 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "xmlscan.hpp"
+
+using std::string;
+
+namespace neuralpp  {
+	size_t xmlscan::markupEnd (const char *p, size_t n)  {
+		const char *term = ">";
+		size_t skip = 1;
+
+		if (n >= 4 && !strncmp(p, "<!--", 4))  {
+			term = "-->";
+			skip = 4;
+		} else if (n >= 9 && !strncmp(p, "<![CDATA[", 9))  {
+			term = "]]>";
+			skip = 9;
+		} else if (n >= 2 && p[1] == '?')  {
+			term = "?>";
+			skip = 2;
+		} else if (n < 9 && (n < 2 || p[1] == '!'))  {
+			// Too short to tell a comment or a CDATA section from a declaration
+			return 0;
+		}
+
+		if (term[1])  {
+			size_t len = strlen(term);
+
+			for (size_t i = skip; i + len <= n; i++)
+				if (!strncmp(p + i, term, len))
+					return i + len;
+			return 0;
+		}
+
+		// Tags and declarations: skip quoted values and the internal subset of a DOCTYPE
+		char quote = 0;
+		int brackets = 0;
+
+		for (size_t i = skip; i < n; i++)  {
+			if (quote)  {
+				if (p[i] == quote)
+					quote = 0;
+			} else if (p[i] == '"' || p[i] == '\'')
+				quote = p[i];
+			else if (p[i] == '[')
+				brackets++;
+			else if (p[i] == ']')
+				brackets--;
+			else if (p[i] == '>' && brackets <= 0)
+				return i + 1;
+		}
+
+		return 0;
+	}
+
+	const char* xmlscan::nextAttrib (const char *p, const char *end, const char *&name,
+			size_t& len, const char *&value)  {
+		while (p < end)  {
+			while (p < end && isspace((unsigned char) *p))
+				p++;
+
+			const char *n = p;
+
+			while (p < end && *p != '=' && *p != '/' && !isspace((unsigned char) *p))
+				p++;
+
+			const char *n_end = p;
+
+			while (p < end && isspace((unsigned char) *p))
+				p++;
+
+			// Stray characters or attributes without a value
+			if (p == n || p >= end || *p != '=')  {
+				p++;
+				continue;
+			}
+
+			for (p++; p < end && isspace((unsigned char) *p); p++);
+
+			if (p >= end || (*p != '"' && *p != '\''))
+				return NULL;
+
+			const char *v_end = (const char*) memchr(p + 1, *p, end - p - 1);
+
+			if (!v_end)
+				return NULL;
+
+			name = n;
+			len = n_end - n;
+			value = p + 1;
+			return v_end + 1;
+		}
+
+		return NULL;
+	}
+
+	const char* xmlscan::attrib (const char *p, const char *end, const char *name)  {
+		size_t len = strlen(name), n_len;
+		const char *n, *v;
+
+		while ((p = nextAttrib(p, end, n, n_len, v)))
+			if (n_len == len && !strncmp(n, name, len))
+				return v;
+
+		return NULL;
+	}
+
+	bool xmlscan::valueIs (const char *v, const char *s)  {
+		size_t len = strlen(s);
+		return !strncmp(v, s, len) && v[len] == v[-1];
+	}
+
+	void xmlscan::appendUnsigned (string& s, size_t n)  {
+		char tmp[24];
+		char *p = tmp + sizeof(tmp);
+
+		do  {
+			*--p = '0' + (n % 10);
+			n /= 10;
+		} while (n);
+
+		s.append(p, tmp + sizeof(tmp) - p);
+	}
+
+	void xmlscan::appendReal (string& s, double x, bool single)  {
+		// Integral values, the most common ones in generated sets, skip printf()
+		if (x == floor(x) && fabs(x) < 4e9)  {
+			if (x < 0)
+				s += '-';
+
+			appendUnsigned(s, (size_t) fabs(x));
+			return;
+		}
+
+		char num[40];
+		int digits = (single) ? 6 : 15;
+		int max_digits = (single) ? 9 : 17;
+
+		for (;; digits++)  {
+			sprintf(num, "%.*g", digits, x);
+
+			if (digits == max_digits)
+				break;
+
+			double y = strtod(num, NULL);
+
+			if ((single) ? ((float) y == (float) x) : (y == x))
+				break;
+		}
+
+		s += num;
+	}
+
+	void xmlscan::appendHex (string& s, double x)  {
+		// printf()'s %a is C99: the digits are taken four bits at a time, which is
+		// exact in double arithmetic
+		static const char digits[] = "0123456789abcdef";
+
+		if (x != x || fabs(x) > DBL_MAX)  {
+			appendReal(s, x, false);
+			return;
+		}
+
+		if (x < 0 || (x == 0 && 1/x < 0))  {
+			s += '-';
+			x = -x;
+		}
+
+		if (x == 0)  {
+			s += "0x0p+0";
+			return;
+		}
+
+		int e;
+		double m = 2 * frexp(x, &e) - 1;
+		char exp[16];
+
+		s += "0x1";
+
+		if (m > 0)
+			s += '.';
+
+		while (m > 0)  {
+			m *= 16;
+			int d = (int) m;
+			s += digits[d];
+			m -= d;
+		}
+
+		sprintf(exp, "p%+d", e - 1);
+		s += exp;
+	}
+}
+
@@ -0,0 +1,93 @@
+/**************************************************************************************************
+ * LibNeural++ v.0.4 - All-purpose library for managing neural networks                           *
+ * Copyright (C) 2009, BlackLight                                                                 *
+ *                                                                                                *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the *
+ * GNU General Public License as published by the Free Software Foundation, either version 3 of   *
+ * the License, or (at your option) any later version. This program is distributed in the hope    *
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for    *
+ * more details. You should have received a copy of the GNU General Public License along with     *
+ * this program. If not, see <http://www.gnu.org/licenses/>.                                      *
+ **************************************************************************************************/
+
+#ifndef __NEURALPP_XMLSCAN
+#define __NEURALPP_XMLSCAN
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @namespace neuralpp::xmlscan
+ * @brief Helpers for the dedicated XML readers and writers of the library (training
+ *  sets and networks), which scan the markup in place instead of building a document
+ *  tree, and format numbers straight into an output buffer
+ */
+namespace neuralpp  {
+	namespace xmlscan  {
+		/**
+		 * @brief Find the end of a piece of markup: a tag, a comment, a CDATA section,
+		 *  a declaration (DOCTYPE included) or a processing instruction
+		 * @param p Start of the markup (p[0] == '<')
+		 * @param n Number of characters available from p
+		 * @return Length of the markup (up to its closing '>' included), or 0 if it's
+		 *  not complete within the n characters
+		 */
+		size_t markupEnd (const char *p, size_t n);
+
+		/**
+		 * @brief Read the next attribute of a tag
+		 * @param p Position in the attributes of the tag (just after its name at first)
+		 * @param end End of the tag (its closing '>')
+		 * @param name Set to the name of the attribute
+		 * @param len Set to the length of the name
+		 * @param value Set to the value of the attribute (just after its opening quote)
+		 * @return Position just after the attribute, to read the next one from, or NULL
+		 *  if there are no more attributes
+		 */
+		const char* nextAttrib (const char *p, const char *end, const char *&name,
+				size_t& len, const char *&value);
+
+		/**
+		 * @brief Find an attribute of a tag
+		 * @param p Start of the attributes of the tag (just after its name)
+		 * @param end End of the tag (its closing '>')
+		 * @param name Name of the attribute
+		 * @return Pointer to the value of the attribute (just after its opening quote),
+		 *  or NULL if the tag has no such attribute. The value ends at the same kind of
+		 *  quote it starts after (p[-1])
+		 */
+		const char* attrib (const char *p, const char *end, const char *name);
+
+		/**
+		 * @brief Compare the value of an attribute with a string
+		 * @param v Value, as returned by attrib()
+		 * @param s String
+		 * @return true if the value is exactly s
+		 */
+		bool valueIs (const char *v, const char *s);
+
+		/**
+		 * @brief Append the decimal digits of an unsigned number to a string
+		 */
+		void appendUnsigned (std::string& s, size_t n);
+
+		/**
+		 * @brief Append a real number to a string, with the fewest significant digits
+		 *  that read back to the same number
+		 * @param s String
+		 * @param x Number
+		 * @param single If true, the digits only need to read back to the same float
+		 */
+		void appendReal (std::string& s, double x, bool single);
+
+		/**
+		 * @brief Append a real number to a string as an exact hexadecimal floating point
+		 *  literal (e.g. 0x1.8p+1 for 3), which strtod() reads back
+		 */
+		void appendHex (std::string& s, double x);
+	}
+}
+
+#endif
+